@@ -133,6 +133,8 @@ HEADERS +=  $$files($$SRC/Audio/*.h)
 HEADERS +=  $$files($$SRC/MenusAndDialogs/*.h)
 HEADERS +=  $$files($$SRC/MainStructure/*.h)
 HEADERS +=  $$SRC/Network/FLServerHttp.h \
+			$$SRC/Network/FLOscBundler.h \
+			$$SRC/Network/FLOscServer.h \
 			$$SRC/Network/HTTPWindow.h \
 			$$FAUSTINC/faust/gui/QTUI.h
 
@@ -141,6 +143,8 @@ SOURCES +=	$$files($$SRC/Audio/*.cpp)
 SOURCES +=	$$files($$SRC/MenusAndDialogs/*.cpp) 
 SOURCES +=	$$files($$SRC/MainStructure/*.cpp) 
 SOURCES +=	$$SRC/Network/FLServerHttp.cpp \
+			$$SRC/Network/FLOscBundler.cpp \
+			$$SRC/Network/FLOscServer.cpp \
 			$$SRC/Network/HTTPWindow.cpp
 
 ############################## 
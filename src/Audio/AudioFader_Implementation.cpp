@@ -10,6 +10,239 @@
 
 #include "AudioFader_Implementation.h"
 #include <stdio.h>
+#include <math.h>
+#include <chrono>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <limits.h>
+#elif !defined(__APPLE__)
+#include <errno.h>
+#include <time.h>
+#endif
+
+/******************************************************************************
+ *******************************************************************************
+ 
+ AUDIO FADER Semaphore
+ 
+ *******************************************************************************
+ *******************************************************************************/
+
+#if defined(__APPLE__)
+
+AudioFader_Semaphore::AudioFader_Semaphore()
+{
+    fSemaphore = dispatch_semaphore_create(0);
+}
+
+AudioFader_Semaphore::~AudioFader_Semaphore()
+{
+    dispatch_release(fSemaphore);
+}
+
+void AudioFader_Semaphore::post()
+{
+    dispatch_semaphore_signal(fSemaphore);
+}
+
+void AudioFader_Semaphore::wait()
+{
+    dispatch_semaphore_wait(fSemaphore, DISPATCH_TIME_FOREVER);
+}
+
+bool AudioFader_Semaphore::wait(int timeoutMs)
+{
+    return dispatch_semaphore_wait(fSemaphore, dispatch_time(DISPATCH_TIME_NOW, (int64_t)timeoutMs * NSEC_PER_MSEC)) == 0;
+}
+
+#elif defined(_WIN32)
+
+AudioFader_Semaphore::AudioFader_Semaphore()
+{
+    fSemaphore = CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+}
+
+AudioFader_Semaphore::~AudioFader_Semaphore()
+{
+    CloseHandle(fSemaphore);
+}
+
+void AudioFader_Semaphore::post()
+{
+    ReleaseSemaphore(fSemaphore, 1, NULL);
+}
+
+void AudioFader_Semaphore::wait()
+{
+    WaitForSingleObject(fSemaphore, INFINITE);
+}
+
+bool AudioFader_Semaphore::wait(int timeoutMs)
+{
+    return WaitForSingleObject(fSemaphore, timeoutMs) == WAIT_OBJECT_0;
+}
+
+#else
+
+AudioFader_Semaphore::AudioFader_Semaphore()
+{
+    sem_init(&fSemaphore, 0, 0);
+}
+
+AudioFader_Semaphore::~AudioFader_Semaphore()
+{
+    sem_destroy(&fSemaphore);
+}
+
+void AudioFader_Semaphore::post()
+{
+    sem_post(&fSemaphore);
+}
+
+void AudioFader_Semaphore::wait()
+{
+    while (sem_wait(&fSemaphore) == -1 && errno == EINTR) {}
+}
+
+bool AudioFader_Semaphore::wait(int timeoutMs)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeoutMs / 1000;
+    deadline.tv_nsec += (timeoutMs % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    
+    int res;
+    while ((res = sem_timedwait(&fSemaphore, &deadline)) == -1 && errno == EINTR) {}
+    return res == 0;
+}
+
+#endif
+
+/******************************************************************************
+ *******************************************************************************
+ 
+ AUDIO FADER Quiescence
+ 
+ *******************************************************************************
+ *******************************************************************************/
+
+AudioFader_Quiescence::AudioFader_Quiescence()
+{
+    fAudioEpoch = 0;
+    fWaitQuiescence = false;
+}
+
+void AudioFader_Quiescence::end_Callback()
+{
+    fAudioEpoch++;
+    
+    if (fWaitQuiescence.exchange(false)) {
+        fQuiescent.post();
+    }
+}
+
+//A callback running during the call has loaded what was replaced before : once it ends, nothing refers to it anymore
+bool AudioFader_Quiescence::wait(int timeoutMs)
+{
+    unsigned epoch = fAudioEpoch;
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    
+    while (fAudioEpoch == epoch) {
+        
+        fWaitQuiescence = true;
+        
+        // The callback may have ended before it could see the flag
+        if (fAudioEpoch != epoch) {
+            break;
+        }
+        
+        int remaining = int(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count());
+        
+        // A post left by a previous wait only costs one more turn of the loop
+        if (remaining <= 0 || !fQuiescent.wait(remaining)) {
+            return fAudioEpoch != epoch;
+        }
+    }
+    
+    return true;
+}
+
+/******************************************************************************
+ *******************************************************************************
+ 
+ AUDIO FADER Load meter
+ 
+ *******************************************************************************
+ *******************************************************************************/
+
+AudioFader_LoadMeter::AudioFader_LoadMeter()
+{
+    fComputeTime = 0;
+    fPeriodTime = 0;
+    fPeak = 0;
+    fResetPeak = false;
+    fXruns = 0;
+    fOverBudget = 0;
+    fPeriodStart = 0;
+    fLastComputeTime = 0;
+    fLastPeriodTime = 0;
+}
+
+//steady_clock reads the TSC through the vDSO on Linux and mach_absolute_time on OSX : it does not block the audio thread
+uint64_t AudioFader_LoadMeter::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void AudioFader_LoadMeter::end_Period(int numFrames, int sampleRate)
+{
+    uint64_t computeTime = now() - fPeriodStart;
+    
+    if (numFrames <= 0 || sampleRate <= 0) {
+        return;
+    }
+    
+    uint64_t periodTime = uint64_t(numFrames) * 1000000000ULL / uint64_t(sampleRate);
+    float load = 100.f * float(computeTime) / float(periodTime);
+    
+    fComputeTime.fetch_add(computeTime, std::memory_order_relaxed);
+    fPeriodTime.fetch_add(periodTime, std::memory_order_release);
+    
+    if (fResetPeak.exchange(false) || load > fPeak) {
+        fPeak = load;
+    }
+    
+    if (computeTime > periodTime) {
+        fOverBudget++;
+    }
+}
+
+void AudioFader_LoadMeter::get_Load(AudioLoad& load)
+{
+    uint64_t periodTime = fPeriodTime.load(std::memory_order_acquire);
+    uint64_t computeTime = fComputeTime.load(std::memory_order_relaxed);
+    
+    if (periodTime > fLastPeriodTime) {
+        load.fAverage = 100.f * float(computeTime - fLastComputeTime) / float(periodTime - fLastPeriodTime);
+        load.fPeak = fPeak;
+        fResetPeak = true;
+    } else {
+        // No period since the previous reading
+        load.fAverage = 0;
+        load.fPeak = 0;
+    }
+    
+    load.fXruns = fXruns;
+    load.fOverBudget = fOverBudget;
+    
+    fLastComputeTime = computeTime;
+    fLastPeriodTime = periodTime;
+}
 
 /******************************************************************************
  *******************************************************************************
@@ -21,6 +254,10 @@
 
 AudioFader_Implementation::AudioFader_Implementation()
 {
+    fFadeCurve = kLinearFade;
+    fFadeIncrement = kFadeCoefficient;
+    fInCoef = 1;
+    fOutCoef = 1;
     reset_Values();
 }
 
@@ -43,50 +280,98 @@ bool AudioFader_Implementation::get_doWeFadeOut()
 
 void AudioFader_Implementation::reset_Values()
 {
-    fNumberOfFadeProcess = 0;
-    fInCoef = 1;
-    fOutCoef = 1;
     fDoWeFadeOut = false;
     fDoWeFadeIn = false;
+    fResetCoefs = true;
 }
 
+void AudioFader_Implementation::set_FadeParameters(float durationMs, int curve, int sampleRate)
+{
+    if (durationMs < kMinFadeDuration) {
+        durationMs = kMinFadeDuration;
+    } else if (durationMs > kMaxFadeDuration) {
+        durationMs = kMaxFadeDuration;
+    }
+    
+    float numFrames = durationMs * sampleRate / 1000.f;
+    fFadeIncrement = (numFrames > 1) ? 1.f / numFrames : 1.f;
+    fFadeCurve = curve;
+}
+
+//The coefficients have already been decremented frame by frame : the fade is over once they reach 0
 void AudioFader_Implementation::increment_crossFade()
 {
-    if (fNumberOfFadeProcess != kNumberOfCrossFadeProcess && fOutCoef > 0) {
-        fInCoef = fInCoef - kFadeCoefficient;  
-        fOutCoef = fInCoef;
-        fNumberOfFadeProcess++;
+    if (fOutCoef <= 0) {
+        fInCoef = 1;
+        fOutCoef = 1;
+        fDoWeFadeOut = false;
+        fDoWeFadeIn = false;
+    }
+}
+
+float AudioFader_Implementation::fade_Gain(float coef)
+{
+    if (coef <= 0) {
+        return 0;
+    } else if (coef >= 1) {
+        return 1;
+    } else if (fFadeCurve == kEqualPowerFade) {
+        return sinf(coef * 1.57079632679f);
+    } else if (fFadeCurve == kSCurveFade) {
+        return coef * coef * (3 - 2 * coef);
     } else {
-        reset_Values();
+        return coef;
     }
 }
 
+void AudioFader_Implementation::apply_GainRamp(float* buffer, int numFrames, float startGain, float endGain)
+{
+    if (numFrames <= 0) {
+        return;
+    }
+    
+    float step = (endGain - startGain) / numFrames;
+    for (int i = 0; i < numFrames; i++) {
+        buffer[i] *= startGain + step * i;
+    }
+}
+
+//The coefficient goes down by fFadeIncrement per frame. The gains at both ends of the block are computed once,
+//then each channel is processed with a gain ramp
 void AudioFader_Implementation::crossfade_Calcul(int numFrames, int numOutputs, float** outBuffer)
 {
+    check_Reset();
+    
+    float startCoef = (fDoWeFadeOut) ? fOutCoef : fInCoef;
+    float endCoef = startCoef - numFrames * fFadeIncrement;
+    
+    if (endCoef < 0) {
+        endCoef = 0;
+    }
+    
     if (fDoWeFadeOut) {
         
-        for (int j = 0; j < numFrames ; j++) {
-            
-            for (int i = 0; i < numOutputs; i++)
-                outBuffer[i][j] = outBuffer[i][j] * fOutCoef;
-            
-            if (fOutCoef > 0) {
-                fOutCoef = fOutCoef - kFadeCoefficient;
-                fInCoef = fOutCoef;
-            }
+        float startGain = fade_Gain(startCoef);
+        float endGain = fade_Gain(endCoef);
+        
+        for (int i = 0; i < numOutputs; i++) {
+            apply_GainRamp(outBuffer[i], numFrames, startGain, endGain);
         }
+        
+        fOutCoef = endCoef;
+        fInCoef = fOutCoef;
+        
     } else if (fDoWeFadeIn) {
         
-        for (int j = 0; j < numFrames ; j++) {
-            
-            for (int i = 0; i < numOutputs; i++)
-                outBuffer[i][j] = outBuffer[i][j] * (1-fInCoef);
-            
-            if ((1-fInCoef) < 1) {
-                fInCoef = fInCoef - kFadeCoefficient;
-                fOutCoef = fInCoef;
-            }
-        }  
+        float startGain = fade_Gain(1 - startCoef);
+        float endGain = fade_Gain(1 - endCoef);
+        
+        for (int i = 0; i < numOutputs; i++) {
+            apply_GainRamp(outBuffer[i], numFrames, startGain, endGain);
+        }
+        
+        fInCoef = endCoef;
+        fOutCoef = fInCoef;
     }
     
     if (fDoWeFadeIn || fDoWeFadeOut)
@@ -16,22 +16,161 @@
 //#define kFadeInCoefficient 1.000356
 //#define kFadeOutCoefficient 1.000186
 
-#define kNumberOfCrossFadeProcess 60
-#define kFadeCoefficient 0.00003255f
+#define kFadeCoefficient 0.00003255f    // Default step of the fade coefficient per frame, used until set_FadeParameters is called
 //#define kFadeOutCoefficient 0.000386
 
+#define kDefaultFadeDuration 700    // ms : about the length of the former fixed fade at 44.1 kHz
+#define kMinFadeDuration 1          // ms
+#define kMaxFadeDuration 10000      // ms
+
+#define kFadeTimeOut 3000   // ms : in case the audio callback is not called anymore, the fade is forced to stop (added to the fade duration)
+#define kQuiescenceTimeOut 500  // ms : the audio callback may not be called anymore (server stopped)
+
+// Shape of the gain applied during a crossfade
+enum FadeCurve {
+    kLinearFade,
+    kEqualPowerFade,
+    kSCurveFade
+};
+
+#include <atomic>
+#include <stdint.h>
+
+#if defined(__APPLE__)
+#include <dispatch/dispatch.h>
+#elif !defined(_WIN32)
+#include <semaphore.h>
+#endif
+
+// Semaphore posted by the audio thread (posting does not block nor allocate)
+class AudioFader_Semaphore
+{
+    private:
+    
+    #if defined(__APPLE__)
+        dispatch_semaphore_t fSemaphore;
+    #elif defined(_WIN32)
+        void* fSemaphore;   // HANDLE, windows.h is only included in the implementation
+    #else
+        sem_t fSemaphore;
+    #endif
+    
+    public:
+    
+        AudioFader_Semaphore();
+        ~AudioFader_Semaphore();
+    
+        void post();
+    
+        void wait();
+    
+        //Returns false if timeoutMs elapsed before a post
+        bool wait(int timeoutMs);
+};
+
+// Handoff with the audio thread : it acknowledges the end of each callback with an epoch
+class AudioFader_Quiescence
+{
+    private:
+    
+        AudioFader_Semaphore    fQuiescent;
+        std::atomic<unsigned>   fAudioEpoch;
+        std::atomic<bool>       fWaitQuiescence;
+    
+    public:
+    
+        AudioFader_Quiescence();
+    
+        //To be called by the audio thread at the end of each callback : what it used before may be reclaimed
+        void end_Callback();
+    
+        //Blocks until the audio thread ends a callback. What was replaced before the call is not used anymore
+        //Returns false if timeoutMs elapsed before (the callback may not be called anymore)
+        bool wait(int timeoutMs);
+};
+
+// DSP load of the audio callback, in % of the period duration
+struct AudioLoad
+{
+    float   fAverage;       // Since the previous reading
+    float   fPeak;          // Most expensive period since the previous reading
+    int     fXruns;         // Reported by the audio driver (JACK only), since the audio was started
+    int     fOverBudget;    // Periods that took longer than their duration, since the audio was started
+    
+    AudioLoad() : fAverage(0), fPeak(0), fXruns(0), fOverBudget(0) {}
+};
+
+// Measures the audio callback : it is written by the audio thread and read by the GUI thread, without lock
+class AudioFader_LoadMeter
+{
+    private:
+    
+    //Written by the audio thread
+        std::atomic<uint64_t>   fComputeTime;   // ns, cumulated since the start
+        std::atomic<uint64_t>   fPeriodTime;    // ns, cumulated since the start
+        std::atomic<float>      fPeak;
+        std::atomic<bool>       fResetPeak;     // Set by the reader, the next period restarts the peak
+        std::atomic<int>        fXruns;
+        std::atomic<int>        fOverBudget;
+        uint64_t                fPeriodStart;
+    
+    //Read by the GUI thread only
+        uint64_t                fLastComputeTime;
+        uint64_t                fLastPeriodTime;
+    
+    public:
+    
+        AudioFader_LoadMeter();
+    
+        static uint64_t now();  // ns, monotonic
+    
+        void begin_Period() { fPeriodStart = now(); }
+        void end_Period(int numFrames, int sampleRate);
+        void add_Xrun() { fXruns++; }
+    
+        void get_Load(AudioLoad& load);
+};
+
 class AudioFader_Implementation
 {
+    private:
+    
+        AudioFader_Quiescence fQuiescence;
+    
+        std::atomic<bool> fResetCoefs;   // Asked by reset_Values, done by the audio thread
+    
     protected:
     
-        volatile bool fDoWeFadeOut;
-        volatile bool fDoWeFadeIn;
+        std::atomic<bool> fDoWeFadeOut;
+        std::atomic<bool> fDoWeFadeIn;
         
-        float   fInCoef;                 // Coefficients of multiplication   
-        float   fOutCoef;                // during audio crossfade
-        int     fNumberOfFadeProcess;    // Number of fade out process before considering that the signal is almost null
+        float   fInCoef;                 // Coefficients of multiplication during audio crossfade,
+        float   fOutCoef;                // only written by the audio thread
+        float   fFadeIncrement;          // Step of the coefficients per frame, from the fade duration and the sample rate
+        int     fFadeCurve;
+    
+        AudioFader_LoadMeter fLoadMeter;  // begin_Period/end_Period around the compute of the audio callback
         
         void    increment_crossFade();
+    
+        //To be called by the audio thread before it reads the coefficients
+        void    check_Reset()
+        {
+            if (fResetCoefs && fResetCoefs.exchange(false)) {
+                fInCoef = 1;
+                fOutCoef = 1;
+            }
+        }
+    
+        //See AudioFader_Quiescence
+        void    end_Callback() { fQuiescence.end_Callback(); }
+        bool    wait_Quiescence(int timeoutMs) { return fQuiescence.wait(timeoutMs); }
+    
+        //Gain of a signal which crossfade coefficient is coef (1 = fully present, 0 = silent)
+        float   fade_Gain(float coef);
+    
+        //Channel-major gain ramp : buffer[i] *= startGain + (endGain - startGain) * i / numFrames
+        static void apply_GainRamp(float* buffer, int numFrames, float startGain, float endGain);
         
         //Specific to the 2 clients crossfade
         void    crossfade_Calcul(int numFrames, int numOutputs, float** outBuffer);
@@ -44,7 +183,15 @@ class AudioFader_Implementation
         void set_doWeFadeOut(bool val);
         void set_doWeFadeIn(bool val);
         bool get_doWeFadeOut();
+    
+        //Stops the fade. The coefficients are reset by the next callback
         void reset_Values();
+    
+        //Length and shape of the next fades. The fade lasts durationMs whatever the buffer size
+        void set_FadeParameters(float durationMs, int curve, int sampleRate);
+    
+        //To be called from the GUI thread only
+        void get_Load(AudioLoad& load) { fLoadMeter.get_Load(load); }
 
 };
 
@@ -21,7 +21,9 @@ class AudioFader_Interface
     
         virtual void launch_fadeOut() = 0;
         virtual void launch_fadeIn() = 0;
+        //True until the audio thread ends the fade out
         virtual bool get_FadeOut() = 0;
+        virtual void force_stopFade() = 0;
 };
 
 #endif
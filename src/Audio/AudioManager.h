@@ -21,6 +21,7 @@
 #endif
 
 #include "AudioFactory.h"
+#include "AudioFader_Implementation.h"
 #include "faust/audio/audio.h"
 
 using namespace std;
@@ -31,9 +32,14 @@ class AudioManager : public QObject, public audio
 {
     Q_OBJECT
     
+    protected:
+    
+        float   fFadeDuration;  // ms
+        int     fFadeCurve;     // FadeCurve
+    
     public:
     
-        AudioManager(AudioShutdownCallback cb = NULL, void* arg = NULL){Q_UNUSED(cb);Q_UNUSED(arg);}
+        AudioManager(AudioShutdownCallback cb = NULL, void* arg = NULL) : fFadeDuration(kDefaultFadeDuration), fFadeCurve(kLinearFade) {Q_UNUSED(cb);Q_UNUSED(arg);}
         virtual ~AudioManager(){}
         
         virtual bool initAudio(QString& error, const char* name, bool midi) = 0;
@@ -45,7 +51,19 @@ class AudioManager : public QObject, public audio
 
         virtual bool init_FadeAudio(QString& error, const char* name, dsp* DSP) = 0;
         virtual void start_Fade() = 0;
-        virtual void wait_EndFade() = 0;
+    
+        //Does not block : returns false while the fade out is not over. With force, the fade is stopped anyway
+        //Once it returns true, the audio thread does not use the old DSP anymore
+        virtual bool end_Fade(bool force) = 0;
+    
+        //Once elapsed since start_Fade, the crossfade should be forced to end (the audio callback may not be called anymore)
+        int get_FadeTimeOut() { return kFadeTimeOut + int(fFadeDuration); }
+    
+        //Length and shape of the next crossfades, given to the faders in start_Fade
+        void set_FadeParameters(float durationMs, int curve) { fFadeDuration = durationMs; fFadeCurve = curve; }
+    
+        //DSP load of the current audio callback, to be called from the GUI thread
+        virtual void get_Load(AudioLoad& load) { load = AudioLoad(); }
         
         virtual void connect_Audio(std::string homeFolder){Q_UNUSED(homeFolder);}
         virtual void save_Connections(std::string homeFolder){Q_UNUSED(homeFolder);}
@@ -41,10 +41,12 @@ class crossfade_TCoreAudioRenderer: public TCoreAudioRenderer, public AudioFader
                 for (int i = 0; i < fDevNumOutChans; i++) {
                     fOutChannel[i] = (float*)ioData->mBuffers[i].mData;
                 }
+                fLoadMeter.begin_Period();
                 fDSP->compute(double(AudioConvertHostTimeToNanos(inTimeStamp->mHostTime))/1000., inNumberFrames, fInChannel, fOutChannel);
                 
                 // ADDED LINE COMPARING TO BASIC COREAUDIO
                 crossfade_Calcul(inNumberFrames, fDevNumOutChans, fOutChannel);
+                fLoadMeter.end_Period(inNumberFrames, GetSampleRate());
             } else {
                 printError(err);
             }
@@ -129,6 +131,16 @@ class CA_audioFader : public audio, public AudioFader_Interface
             fCrossFadeDevice.set_doWeFadeOut(true);
         }
         
+        void set_FadeParameters(float durationMs, int curve, int sampleRate)
+        {
+            fCrossFadeDevice.set_FadeParameters(durationMs, curve, sampleRate);
+        }
+    
+        void get_Load(AudioLoad& load)
+        {
+            fCrossFadeDevice.get_Load(load);
+        }
+    
         virtual void launch_fadeIn()
         {
             fCrossFadeDevice.set_doWeFadeIn(true);
@@ -145,7 +157,7 @@ class CA_audioFader : public audio, public AudioFader_Interface
         virtual int getNumInputs() { return -1; }
         virtual int getNumOutputs() { return -1; }
     
-        void force_stopFade()
+        virtual void force_stopFade()
         {
             fCrossFadeDevice.reset_Values();
         }
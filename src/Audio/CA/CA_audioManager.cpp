@@ -8,7 +8,6 @@
 
 // CA_audioManager controls 2 CA_audioFader. It can switch from one to another with a crossfade or it can act like a simple coreaudio-dsp
 
-#include <QDateTime>
 
 #if defined(_WIN32) && !defined(GCC)
 # pragma warning (disable: 4100)
@@ -106,6 +105,9 @@ bool CA_audioManager::init_FadeAudio(QString& error, const char* name, dsp* DSP)
 //Crossfade start
 void CA_audioManager::start_Fade()
 {
+    fFadeInAudio->set_FadeParameters(fFadeDuration, fFadeCurve, getSampleRate());
+    fCurrentAudio->set_FadeParameters(fFadeDuration, fFadeCurve, getSampleRate());
+    
     fFadeInAudio->launch_fadeIn();
     fCurrentAudio->launch_fadeOut();
     
@@ -117,17 +119,15 @@ void CA_audioManager::start_Fade()
 }
 
 //When the crossfade ends, FadeInAudio becomes the current audio 
-void CA_audioManager::wait_EndFade()
+bool CA_audioManager::end_Fade(bool force)
 {
-//   In case of CoreAudio Bug : If the Render function is not called, the loop could be infinite. This way, it isn't.
-    QDateTime currentTime(QDateTime::currentDateTime());
-        
-    while (fCurrentAudio->get_FadeOut()) {
-        QDateTime currentTime2(QDateTime::currentDateTime());
-        if (currentTime.secsTo(currentTime2) > 3) {
-            fFadeInAudio->force_stopFade();
-            fCurrentAudio->force_stopFade();
+//   In case of CoreAudio Bug : If the Render function is not called, the wait could be infinite. This way, it isn't.
+    if (fCurrentAudio->get_FadeOut()) {
+        if (!force) {
+            return false;
         }
+        fFadeInAudio->force_stopFade();
+        fCurrentAudio->force_stopFade();
     }
 
     fCurrentAudio->stop();
@@ -135,6 +135,7 @@ void CA_audioManager::wait_EndFade()
     fCurrentAudio = fFadeInAudio;
     fFadeInAudio = intermediate;
     delete fFadeInAudio;
+    return true;
 }
 
 int CA_audioManager::getBufferSize()
@@ -147,4 +148,9 @@ int CA_audioManager::getSampleRate()
     return fCurrentAudio->getSampleRate();
 }
 
+void CA_audioManager::get_Load(AudioLoad& load)
+{
+    fCurrentAudio->get_Load(load);
+}
+
 
@@ -10,42 +10,38 @@
 // Moreover, the two dsp will be switched with a crossfade between them. 
 
 #include "JA_audioFader.h"
+#include "JA_sharedClient.h"
 #include "FLSettings.h"
+#include <string.h>
 
-//Calculation of sample[i,j] mixing 2 dsp (one fading in/one fading out)
-float JA_audioFader::crossfade_calculation(int i, int j)
+//Routing of the output ports : 1 if the port is connected in the JACK graph, 0 otherwise
+//It is computed once when the fade is armed, so that the audio thread does not compare port names
+void JA_audioFader::compute_Routing(const list<pair<string, string> >& connections, vector<float>& routing)
 {
-    bool connectFadeOut = false;
-    bool connectFadeIn = false;
-    list<pair<string, string> >::const_iterator it;
-     
-    for (it = fConnections.begin(); it != fConnections.end(); it++) {
-        string jackPort(jack_port_name(fOutputPorts[j]));
-        if (jackPort.compare(it->first) == 0) {
-            connectFadeOut = true;
-            break;
-        }
-    }
-    for (it = fConnectionsIn.begin(); it != fConnectionsIn.end(); it++) {
+    routing.assign(fOutputPorts.size(), 0.f);
+    
+    for (size_t j = 0; j < fOutputPorts.size(); j++) {
         string jackPort(jack_port_name(fOutputPorts[j]));
-        if (jackPort.compare(it->first) == 0) {
-            connectFadeIn = true;
-            break;
+        list<pair<string, string> >::const_iterator it;
+        
+        for (it = connections.begin(); it != connections.end(); it++) {
+            if (jackPort.compare(it->first) == 0) {
+                routing[j] = 1.f;
+                break;
+            }
         }
     }
-    
-    if (connectFadeIn && connectFadeOut) {
-        return (fIntermediateFadeIn[j][i] * (1-fInCoef)) + (fIntermediateFadeOut[j][i] * fOutCoef);
-    } else if (connectFadeIn) {
-        return (fIntermediateFadeIn[j][i] * (1-fInCoef));
-    } else if (connectFadeOut) {
-        return (fIntermediateFadeOut[j][i] * fOutCoef);
-    } else {
-        return 0;
+}
+
+//Mixing of one output channel from the faded buffers of both DSP
+static inline void mix_Channel(float* out, const float* fadeIn, float inRouting, const float* fadeOut, float outRouting, int nframes)
+{
+    for (int i = 0; i < nframes; i++) {
+        out[i] = (fadeIn[i] * inRouting) + (fadeOut[i] * outRouting);
     }
 }
 
-JA_audioFader::JA_audioFader() :jackaudio_midi()
+JA_audioFader::JA_audioFader(bool shared) :jackaudio_midi()
 {
     if (FLSettings::_Instance()->value("General/Audio/Jack/AutoStart", true).toBool()) {
         unsetenv("JACK_NO_START_SERVER");
@@ -53,11 +49,219 @@ JA_audioFader::JA_audioFader() :jackaudio_midi()
         char* val_on = "1";
         setenv("JACK_NO_START_SERVER", val_on, 1);
     }
+    
+    fScratch = NULL;
+    fRetiredScratch = NULL;
+    
+    fSharedClient = NULL;
+    fShared = shared;
+    fSharedRunning = false;
+    fSharedShutdown = NULL;
+    fSharedShutdownArg = NULL;
+    fSharedInputs = NULL;
+    fNumSharedInputs = 0;
+    
+    fState = new audioState();
+    fFadeInPromoted = false;
+    fActive = false;
+    
     reset_Values();
 }
 
+//Layout of the arena : numChannels fade out buffers, then numChannels fade in buffers
+JA_audioFader::scratchArena::scratchArena(int numChannels, jack_nframes_t frames)
+{
+    int numBuffers = 2 * numChannels;
+    fBuffers.assign(numBuffers * frames, 0.f);
+    fChannels.resize(numBuffers);
+    
+    for (int i = 0; i < numBuffers; i++) {
+        fChannels[i] = &fBuffers[i * frames];
+    }
+    
+    fFadeOut = &fChannels[0];
+    fFadeIn = &fChannels[numChannels];
+    
+    fNumChannels = numChannels;
+    fFrames = frames;
+    fNext = NULL;
+}
+
+//The audio thread keeps the arena it loaded until the end of its callback : the replaced one is only retired
+void JA_audioFader::allocate_Scratch(int numChannels, jack_nframes_t frames)
+{
+    retire_Scratch(fScratch.exchange(new scratchArena(numChannels, frames)));
+}
+
+void JA_audioFader::retire_Scratch(scratchArena* arena)
+{
+    while (arena) {
+        scratchArena* next = arena->fNext;
+        arena->fNext = fRetiredScratch.load();
+        while (!fRetiredScratch.compare_exchange_weak(arena->fNext, arena)) {}
+        arena = next;
+    }
+}
+
+void JA_audioFader::delete_Scratch(scratchArena* arena)
+{
+    while (arena) {
+        scratchArena* next = arena->fNext;
+        delete arena;
+        arena = next;
+    }
+}
+
+//The arena follows the buffer size of the JACK server
+int JA_audioFader::_jack_buffersize_fader(jack_nframes_t nframes, void* arg)
+{
+    JA_audioFader* fader = static_cast<JA_audioFader*>(arg);
+    scratchArena* arena = fader->fScratch.load();
+    
+    if (arena && arena->fFrames != nframes) {
+        fader->allocate_Scratch(arena->fNumChannels, nframes);
+    }
+    
+    return 0;
+}
+
+//In single client mode, the base destructor must neither deactivate nor close the shared client
 JA_audioFader::~JA_audioFader() 
-{}
+{
+    // The audio state is not used anymore once the callback is stopped
+    stop();
+    
+    if (fSharedClient) {
+        for (size_t i = 0; i < fInputPorts.size(); i++) {
+            jack_port_unregister(fClient, fInputPorts[i]);
+        }
+        for (size_t i = 0; i < fOutputPorts.size(); i++) {
+            jack_port_unregister(fClient, fOutputPorts[i]);
+        }
+        fInputPorts.clear();
+        fOutputPorts.clear();
+        
+        fClient = NULL;
+        fSharedClient->release();
+        fSharedClient = NULL;
+    }
+    
+    delete fState.load();
+    for (size_t i = 0; i < fRetiredStates.size(); i++) {
+        delete fRetiredStates[i];
+    }
+    
+    delete_Scratch(fScratch.load());
+    delete_Scratch(fRetiredScratch.load());
+}
+
+//The audio thread loads the state once per callback : the previous one is reclaimed here once a callback has ended
+void JA_audioFader::publish_State(dsp* fadeInDSP)
+{
+    audioState* state = new audioState();
+    state->fDSP = fDSP;
+    state->fDSPIn = fadeInDSP;
+    state->fInputPorts = fInputPorts;
+    state->fOutputPorts = fOutputPorts;
+    
+    fRetiredStates.push_back(fState.exchange(state));
+    
+    // The arenas retired from now on may still be used by a callback started after the wait
+    scratchArena* retiredScratch = fRetiredScratch.exchange(NULL);
+    
+    // A callback may still be reading the retired states if it did not end in time : they are kept for a next publication
+    if (fActive && !wait_Quiescence(kQuiescenceTimeOut)) {
+        retire_Scratch(retiredScratch);
+        return;
+    }
+    
+    for (size_t i = 0; i < fRetiredStates.size(); i++) {
+        delete fRetiredStates[i];
+    }
+    fRetiredStates.clear();
+    delete_Scratch(retiredScratch);
+}
+
+bool JA_audioFader::init(const char* name, dsp* DSP)
+{
+    if (!fShared) {
+        return jackaudio_midi::init(name, DSP);
+    }
+    
+    fSharedClient = JA_sharedClient::acquire();
+    
+    if (!fSharedClient) {
+        return false;
+    }
+    
+    fClient = fSharedClient->getClient();
+    fPortsPrefix = name;
+    
+    if (DSP) {
+        set_dsp(DSP, name);
+    }
+    
+    return true;
+}
+
+void JA_audioFader::setShutdownCallback(shutdown_callback cb, void* arg)
+{
+    fSharedShutdown = cb;
+    fSharedShutdownArg = arg;
+    jackaudio_midi::setShutdownCallback(cb, arg);
+}
+
+void JA_audioFader::shutdown_Shared(const char* reason)
+{
+    if (fSharedShutdown) {
+        fSharedShutdown(reason, fSharedShutdownArg);
+    }
+}
+
+//Called by the shared client, from the process thread or one of its workers
+void JA_audioFader::compute_Shared(jack_nframes_t nframes, float** inputs, int numInputs)
+{
+    fSharedInputs = inputs;
+    fNumSharedInputs = numInputs;
+    processAudio(nframes);
+    fSharedInputs = NULL;
+    fNumSharedInputs = 0;
+}
+
+//The input buffer is the output of another window when the shared client chains them
+float* JA_audioFader::input_Buffer(audioState* state, int index, jack_nframes_t nframes)
+{
+    if (index < fNumSharedInputs && fSharedInputs[index]) {
+        return fSharedInputs[index];
+    } else {
+        return (float*)jack_port_get_buffer(state->fInputPorts[index], nframes);
+    }
+}
+
+//The shared client follows the ports and connections of the fader
+void JA_audioFader::update_Graph()
+{
+    if (fSharedRunning) {
+        fSharedClient->updateGraph();
+    }
+}
+
+void JA_audioFader::refresh_Graph()
+{
+    if (fSharedRunning) {
+        fSharedClient->refreshGraph();
+    }
+}
+
+//In single client mode, the name of the window is added to the name of the ports
+void JA_audioFader::port_Name(char* buf, const char* portsName, const char* direction, int index)
+{
+    if (fShared) {
+        snprintf(buf, 256, "%s_%s_%s_%d", fPortsPrefix.c_str(), portsName, direction, index);
+    } else {
+        snprintf(buf, 256, "%s_%s_%d", portsName, direction, index);
+    }
+}
 
  // Special version that names the JACK ports
 bool JA_audioFader::set_dsp(dsp* dsp, const char* portsName)    
@@ -66,30 +270,70 @@ bool JA_audioFader::set_dsp(dsp* dsp, const char* portsName)
     
     for (int i = 0; i < fDSP->getNumInputs(); i++) {
         char buf[256];
-        snprintf(buf, 256, "%s_In_%d", portsName, i);
+        port_Name(buf, portsName, "In", i);
         fInputPorts.push_back(jack_port_register(fClient, buf, JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0));
     }
     for (int i = 0; i < fDSP->getNumOutputs(); i++) {
         char buf[256];
-        snprintf(buf, 256, "%s_Out_%d", portsName, i);
+        port_Name(buf, portsName, "Out", i);
         fOutputPorts.push_back(jack_port_register(fClient, buf, JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0));
     }
     
     fDSP->init(jack_get_sample_rate(fClient));
+    publish_State(NULL);
     return true;
 }
 
+//Counted in the DSP load of the window
+int JA_audioFader::_jack_xrun_fader(void* arg)
+{
+    static_cast<JA_audioFader*>(arg)->fLoadMeter.add_Xrun();
+    return 0;
+}
+
 // Redefine jackaudio method
 bool JA_audioFader::start()
 {
+    // The DSP may have been given by jackaudio::init
+    publish_State(NULL);
+    
+    // The shared client is already active, the fader is computed from the next cycle
+    if (fShared) {
+        if (!fSharedClient || !fSharedClient->addFader(this)) {
+            return false;
+        }
+        fSharedRunning = true;
+        fActive = true;
+        return true;
+    }
+    
+    jack_set_buffer_size_callback(fClient, _jack_buffersize_fader, this);
+    jack_set_xrun_callback(fClient, _jack_xrun_fader, this);
+    
     if (jack_activate(fClient)) {
         fprintf(stderr, "Cannot activate client");
         return false;
     } else {
+        fActive = true;
         return true;
     }
 }
 
+void JA_audioFader::stop()
+{
+    if (!fShared) {
+        if (fActive) {
+            jackaudio_midi::stop();
+        }
+    } else if (fSharedRunning) {
+        saveConnections();
+        fSharedClient->removeFader(this);
+        fSharedRunning = false;
+    }
+    
+    fActive = false;
+}
+
 //Init second DSP in Jack Client
 void JA_audioFader::init_FadeIn_Audio(dsp* DSP, const char* portsName)
 {
@@ -98,12 +342,12 @@ void JA_audioFader::init_FadeIn_Audio(dsp* DSP, const char* portsName)
     //Rename the common ports
     for (int i = 0; i < fDSP->getNumInputs(); i++){
         char buf[256];
-        snprintf(buf, 256, "%s_In_%d", portsName, i);
+        port_Name(buf, portsName, "In", i);
         jack_port_set_name(fInputPorts[i], buf);
     }
     for (int i = 0; i < fDSP->getNumOutputs(); i++){
         char buf[256];
-        snprintf(buf, 256, "%s_Out_%d", portsName, i);
+        port_Name(buf, portsName, "Out", i);
         jack_port_set_name(fOutputPorts[i], buf);
     }
     
@@ -111,7 +355,7 @@ void JA_audioFader::init_FadeIn_Audio(dsp* DSP, const char* portsName)
     if (fDSP->getNumInputs() < fDSPIn->getNumInputs()) {
         for (int i = fDSP->getNumInputs(); i < fDSPIn->getNumInputs(); i++) {
             char buf[256];
-            snprintf(buf, 256, "%s_In_%d", portsName,i);
+            port_Name(buf, portsName, "In", i);
             fInputPorts.push_back(jack_port_register(fClient, buf, JACK_DEFAULT_AUDIO_TYPE, JackPortIsInput, 0));
         }
     }
@@ -119,7 +363,7 @@ void JA_audioFader::init_FadeIn_Audio(dsp* DSP, const char* portsName)
     if (fDSP->getNumOutputs() < fDSPIn->getNumOutputs()) {
         for (int i = fDSP->getNumOutputs(); i < fDSPIn->getNumOutputs(); i++) {
             char buf[256];
-            snprintf(buf, 256, "%s_Out_%d",portsName, i);
+            port_Name(buf, portsName, "Out", i);
             fOutputPorts.push_back(jack_port_register(fClient, buf, JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0));
         }
     }
@@ -127,6 +371,9 @@ void JA_audioFader::init_FadeIn_Audio(dsp* DSP, const char* portsName)
     fDSPIn->init(jack_get_sample_rate(fClient));
     saveConnections();
     fConnectionsIn = fConnections;
+    
+    // The audio thread has the new DSP and ports before the fade is launched
+    publish_State(fDSPIn);
 }
 
 //Connect Jack port following Connections
@@ -137,6 +384,8 @@ int JA_audioFader::reconnect(list<pair<string, string> > Connections)
     for (it = Connections.begin(); it != Connections.end(); it++) {
         jack_connect(fClient, it->first.c_str(), it->second.c_str());
     }
+    
+    update_Graph();
 
     return 0;
 }
@@ -144,39 +393,38 @@ int JA_audioFader::reconnect(list<pair<string, string> > Connections)
 // UpDate the list of ports needed by new DSP
 void JA_audioFader::launch_fadeOut()
 {
-    //Allocation of the intermediate buffers needed for the crossfade
-      
-    fIntermediateFadeIn = new float*[fDSPIn->getNumOutputs()];
-    for(int i = 0; i < fDSPIn->getNumOutputs();i++) {
-        fIntermediateFadeIn[i] = new float[jack_get_buffer_size(fClient)];
-    }
-  
-    fIntermediateFadeOut = new float*[fDSP->getNumOutputs()];
-    for (int i = 0; i < fDSP->getNumOutputs(); i++) {
-        fIntermediateFadeOut[i] = new float[jack_get_buffer_size(fClient)];
+    //The intermediate buffers needed for the crossfade are reused from one fade to the other
+    int numChannels = max(fDSP->getNumOutputs(), fDSPIn->getNumOutputs());
+    jack_nframes_t frames = jack_get_buffer_size(fClient);
+    scratchArena* arena = fScratch.load();
+    
+    if (!arena || numChannels > arena->fNumChannels || frames != arena->fFrames) {
+        allocate_Scratch(max(numChannels, (arena) ? arena->fNumChannels : 0), frames);
     }
     
+    compute_Routing(fConnections, fRoutingOut);
+    compute_Routing(fConnectionsIn, fRoutingIn);
+    
     set_doWeFadeOut(true); 
 }
 
 //Fade In is not needed, because the fade in and out are both launched in the same process
 void JA_audioFader::launch_fadeIn() {}
 bool JA_audioFader::get_FadeOut() { return get_doWeFadeOut(); }
+void JA_audioFader::force_stopFade() { reset_Values(); }
 
-// The inFading DSP becomes the current one
+// The inFading DSP becomes the current one. The audio thread already computes it alone since the end of the crossfade :
+// it is given the new state before the extra ports are unregistered and the previous DSP is deleted by the window
 void JA_audioFader::upDate_DSP()
 {
-    //Erase the extra ports
+    vector<jack_port_t*> extraPorts;
+    
     if (fDSP->getNumInputs() > fDSPIn->getNumInputs()) {
-        for (int i = fDSPIn->getNumInputs(); i < fDSP->getNumInputs(); i++){
-            jack_port_unregister(fClient, fInputPorts[i]);
-        }
+        extraPorts.insert(extraPorts.end(), fInputPorts.begin() + fDSPIn->getNumInputs(), fInputPorts.end());
         fInputPorts.resize(fDSPIn->getNumInputs());
     }
     if (fDSP->getNumOutputs() > fDSPIn->getNumOutputs()) {
-        for (int i = fDSPIn->getNumOutputs(); i < fDSP->getNumOutputs(); i++){
-            jack_port_unregister(fClient, fOutputPorts[i]);
-        }
+        extraPorts.insert(extraPorts.end(), fOutputPorts.begin() + fDSPIn->getNumOutputs(), fOutputPorts.end());
         fOutputPorts.resize(fDSPIn->getNumOutputs());
     }
     
@@ -184,92 +432,117 @@ void JA_audioFader::upDate_DSP()
     fDSP = fDSPIn; 
     fDSPIn = DspInt;
     
-    delete [] fIntermediateFadeOut;
-    delete [] fIntermediateFadeIn;
+    publish_State(NULL);
+    fFadeInPromoted = false;
+    
+    //Erase the extra ports
+    for (size_t i = 0; i < extraPorts.size(); i++) {
+        jack_port_unregister(fClient, extraPorts[i]);
+    }
+    
+    update_Graph();
 }
 
 // JACK callbacks
 void JA_audioFader::processAudio(jack_nframes_t nframes) 
 {
     AVOIDDENORMALS;
+    fLoadMeter.begin_Period();
+    
+    audioState* state = fState.load();
+    
+    if (!state->fDSP) {
+        end_Callback();
+        return;
+    }
+    
+    check_Reset();
+    
+    // Once the crossfade is over, the fading in DSP goes on until the GUI thread publishes it as the current one
+    // The crossfade waits for an arena of the right size if the buffer size has just changed
+    scratchArena* arena = fScratch.load();
+    bool fading = get_doWeFadeOut() && state->fDSPIn && arena && arena->fFrames >= nframes
+        && arena->fNumChannels >= max(state->fDSP->getNumOutputs(), state->fDSPIn->getNumOutputs());
+    dsp* current = (!fading && state->fDSPIn && fFadeInPromoted) ? state->fDSPIn : state->fDSP;
+    
     // Retrieve JACK inputs/output audio buffers
-    float** fInChannel = (float**)alloca(fDSP->getNumInputs() * sizeof(float*));
+    float** fInChannel = (float**)alloca(current->getNumInputs() * sizeof(float*));
     
-    for (int i = 0; i < fDSP->getNumInputs(); i++) {
-        fInChannel[i] = (float*)jack_port_get_buffer(fInputPorts[i], nframes);
+    for (int i = 0; i < current->getNumInputs(); i++) {
+        fInChannel[i] = input_Buffer(state, i, nframes);
     }
     
-    if (get_doWeFadeOut()) {
+    if (fading) {
+        
+        dsp* dspIn = state->fDSPIn;
         
         //Step 1 : Calculation of intermediate buffers
         
         // By convention timestamp of -1 means 'no timestamp conversion' : events already have a timestamp espressed in frames
-        fDSP->compute(-1, nframes, fInChannel, fIntermediateFadeOut);
-        float** fInChannelDspIn = (float**)alloca(fDSPIn->getNumInputs() * sizeof(float*));
+        current->compute(-1, nframes, fInChannel, arena->fFadeOut);
+        float** fInChannelDspIn = (float**)alloca(dspIn->getNumInputs() * sizeof(float*));
         
-        for (int i = 0; i < fDSPIn->getNumInputs(); i++) {
-            fInChannelDspIn[i] = (float*)jack_port_get_buffer(fInputPorts[i], nframes);
+        for (int i = 0; i < dspIn->getNumInputs(); i++) {
+            fInChannelDspIn[i] = input_Buffer(state, i, nframes);
         }
         
         // By convention timestamp of -1 means 'no timestamp conversion' : events already have a timestamp espressed in frames
-        fDSPIn->compute(-1, nframes, fInChannelDspIn, fIntermediateFadeIn); 
+        dspIn->compute(-1, nframes, fInChannelDspIn, arena->fFadeIn); 
         
-        int numOutPorts = max(fDSP->getNumOutputs(), fDSPIn->getNumOutputs());
-		float** fOutFinal = (float**)alloca(numOutPorts * sizeof(float*));
+        //Step 2 : Gain ramps of the crossfade applied in place on the intermediate buffers, like crossfade_Calcul does
         
-        //Step 2 : Mixing the 2 DSP in the final output buffer taking into account the number of IN/OUT ports of the in- and out-coming DSP
+        float startCoef = fInCoef;
+        float endCoef = max(startCoef - nframes * fFadeIncrement, 0.f);
+        
+        for (int j = 0; j < current->getNumOutputs(); j++) {
+            apply_GainRamp(arena->fFadeOut[j], nframes, fade_Gain(startCoef), fade_Gain(endCoef));
+        }
         
-        for (int i = 0; i < numOutPorts; i++) {
-            fOutFinal[i] = (float*)jack_port_get_buffer(fOutputPorts[i], nframes); 
+        for (int j = 0; j < dspIn->getNumOutputs(); j++) {
+            apply_GainRamp(arena->fFadeIn[j], nframes, fade_Gain(1 - startCoef), fade_Gain(1 - endCoef));
         }
         
-        if (fDSP->getNumOutputs() < fDSPIn->getNumOutputs()) {
-            for (size_t i = 0; i < nframes; i++) {
+        fInCoef = endCoef;
+        fOutCoef = fInCoef;
+        
+        //Step 3 : Mixing the 2 DSP channel by channel, taking into account the number of IN/OUT ports of the in- and out-coming DSP
+        
+        int numOutPorts = max(current->getNumOutputs(), dspIn->getNumOutputs());
+        int numCommonPorts = min(current->getNumOutputs(), dspIn->getNumOutputs());
+        
+        for (int j = 0; j < numOutPorts; j++) {
             
-                for (int j = 0; j < fDSP->getNumOutputs(); j++) {
-                    fOutFinal[j][i] = crossfade_calculation(i, j);
-                }
-                
-                for (int j = fDSP->getNumOutputs(); j < fDSPIn->getNumOutputs(); j++) {
-                    fOutFinal[j][i] = fIntermediateFadeIn[j][i]*(1-fInCoef);
-                }
-                
-                if ((1-fInCoef) < 1) {
-                    fInCoef = fInCoef - kFadeCoefficient;
-                }
-                
-                fOutCoef = fInCoef;  
-            }
-        } else {
-            for (size_t i = 0; i < nframes; i++) {
+            float* outFinal = (float*)jack_port_get_buffer(state->fOutputPorts[j], nframes);
             
-                for (int j = 0; j < fDSPIn->getNumOutputs(); j++) {
-                    fOutFinal[j][i] = crossfade_calculation(i, j);
-                }
-                
-                for (int j = fDSPIn->getNumOutputs(); j < fDSP->getNumOutputs(); j++) {
-                    fOutFinal[j][i] = fIntermediateFadeOut[j][i]*fOutCoef;
-                }
-                
-                if ((1-fInCoef) < 1) {
-                    fInCoef = fInCoef - kFadeCoefficient;
-                }
-                
-                fOutCoef = fInCoef;        
-            }   
+            if (j < numCommonPorts) {
+                mix_Channel(outFinal, arena->fFadeIn[j], fRoutingIn[j], arena->fFadeOut[j], fRoutingOut[j], nframes);
+            } else if (j < dspIn->getNumOutputs()) {
+                memcpy(outFinal, arena->fFadeIn[j], nframes * sizeof(float));
+            } else {
+                memcpy(outFinal, arena->fFadeOut[j], nframes * sizeof(float));
+            }
         }
+        
+        // Before the end of the fade is signaled to the GUI thread
+        if (fOutCoef <= 0) {
+            fFadeInPromoted = true;
+        }
+        
         increment_crossFade();
     } else {
     
         //Normal processing
-        float** fOutFinal = (float**)alloca(fDSP->getNumOutputs() * sizeof(float*));
-        for (int i = 0; i < fDSP->getNumOutputs(); i++) {
-            fOutFinal[i] = (float*)jack_port_get_buffer(fOutputPorts[i], nframes);
+        float** fOutFinal = (float**)alloca(current->getNumOutputs() * sizeof(float*));
+        for (int i = 0; i < current->getNumOutputs(); i++) {
+            fOutFinal[i] = (float*)jack_port_get_buffer(state->fOutputPorts[i], nframes);
         }
         
         // By convention timestamp of -1 means 'no timestamp conversion' : events already have a timestamp espressed in frames
-        fDSP->compute(-1, nframes, fInChannel, fOutFinal);   
+        current->compute(-1, nframes, fInChannel, fOutFinal);   
     }
+    
+    fLoadMeter.end_Period(nframes, jack_get_sample_rate(fClient));
+    end_Callback();
 }
 
 // Access to the fade parameter
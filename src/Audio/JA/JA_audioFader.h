@@ -12,37 +12,110 @@
 #ifndef _JA_audioFader_h
 #define _JA_audioFader_h
 
+#include <atomic>
 #include <string>
+#include <vector>
 #include "faust/audio/jack-dsp.h"
 #include "AudioFader_Interface.h"
 #include "AudioFader_Implementation.h"
 
 using namespace std;
 
+class JA_sharedClient;
+
 class JA_audioFader : public jackaudio_midi, public AudioFader_Interface, public AudioFader_Implementation {    
     
+    friend class JA_sharedClient;
+    
     private:
     
         dsp* fDSPIn;
-      
-        float** fIntermediateFadeOut;
-        float** fIntermediateFadeIn;
+    
+    //What the audio thread reads is published as a whole : the previous state is deleted once a callback has ended (see publish_State)
+    //fDSP, fDSPIn and the ports vectors are only used by the GUI thread
+        struct audioState {
+            dsp*                    fDSP;
+            dsp*                    fDSPIn;         // DSP fading in, NULL outside the crossfades
+            vector<jack_port_t*>    fInputPorts;
+            vector<jack_port_t*>    fOutputPorts;
+            
+            audioState() : fDSP(NULL), fDSPIn(NULL) {}
+        };
+    
+        std::atomic<audioState*>    fState;
+        vector<audioState*>         fRetiredStates;     // Replaced states that a callback may still be reading
+        std::atomic<bool>           fFadeInPromoted;    // Set by the audio thread at the end of the crossfade : the fading in DSP goes on alone
+        bool                        fActive;            // The audio callback may be called
+    
+        void publish_State(dsp* fadeInDSP);
+    
+    //Single client mode : the ports are registered on the client shared by the application, that computes the fader
+        JA_sharedClient*    fSharedClient;
+        bool                fShared;
+        bool                fSharedRunning;
+        string              fPortsPrefix;       // Name of the window, the port names have to be unique in the shared client
+        shutdown_callback   fSharedShutdown;
+        void*               fSharedShutdownArg;
+    
+    //Inputs given by the graph of the shared client for the current cycle, NULL when the input is read from JACK
+        float**             fSharedInputs;
+        int                 fNumSharedInputs;
+    
+        void port_Name(char* buf, const char* portsName, const char* direction, int index);
+        void shutdown_Shared(const char* reason);
+        void compute_Shared(jack_nframes_t nframes, float** inputs, int numInputs);
+        void update_Graph();
+        float* input_Buffer(audioState* state, int index, jack_nframes_t nframes);
+    
+    //Scratch arena of the crossfade : intermediate buffers of both DSP
+    //It grows with the number of channels when a fade is armed and follows the JACK buffer size, never freed between fades.
+    //A new arena is built aside and published as a whole, the replaced ones are deleted like the audio states (see publish_State)
+        struct scratchArena {
+            vector<float>   fBuffers;
+            vector<float*>  fChannels;
+            int             fNumChannels;
+            jack_nframes_t  fFrames;
+            float**         fFadeOut;
+            float**         fFadeIn;
+            scratchArena*   fNext;      // In the retired arenas
+            
+            scratchArena(int numChannels, jack_nframes_t frames);
+        };
+    
+        std::atomic<scratchArena*>  fScratch;
+        std::atomic<scratchArena*>  fRetiredScratch;    // Pushed by the GUI thread or the buffer size callback
+    
+        void allocate_Scratch(int numChannels, jack_nframes_t frames);
+        void retire_Scratch(scratchArena* arena);
+        static void delete_Scratch(scratchArena* arena);
+        static int _jack_buffersize_fader(jack_nframes_t nframes, void* arg);
+        static int _jack_xrun_fader(void* arg);
     
         list<pair<string, string> > fConnectionsIn;		// Connections list
+    
+        vector<float> fRoutingOut;      // 1 for the output ports connected before the crossfade, 0 otherwise
+        vector<float> fRoutingIn;       // Same thing for the fading in DSP
         
         virtual void processAudio(jack_nframes_t nframes);
     
-        float crossfade_calculation(int i, int j);
+        void compute_Routing(const list<pair<string, string> >& connections, vector<float>& routing);
     
     public:
     
-        JA_audioFader();
+        JA_audioFader(bool shared = false);
         virtual ~JA_audioFader();
+    
+        virtual bool init(const char* name, dsp* DSP);
         
         // Special version that names the JACK ports
         bool set_dsp(dsp* DSP, const char* portsName);
     
         virtual bool start();
+        virtual void stop();
+    
+        void setShutdownCallback(shutdown_callback cb, void* arg);
+        bool isShared() { return fShared; }
+        void refresh_Graph();
     
         virtual void init_FadeIn_Audio(dsp* DSP, const char* portsName);  
         
@@ -53,6 +126,7 @@ class JA_audioFader : public jackaudio_midi, public AudioFader_Interface, public
         virtual void launch_fadeOut();
         virtual void launch_fadeIn();
         virtual bool get_FadeOut();
+        virtual void force_stopFade();
     
         virtual void upDate_DSP();
 };
@@ -8,6 +8,7 @@
 
 // JA_audioManager controls 1 JA_audioFader. It can switch from one DSP to another with a crossfade or it can act like a simple jackaudio-dsp
 // JA_audioManager also controls the JACK connections of the audio. 
+// In single client mode (General/Audio/Jack/SharedClient), its fader registers its ports on the client shared by all the windows (see JA_sharedClient).
 
 #include "JA_audioManager.h"
 #include "JA_audioFader.h"
@@ -22,7 +23,7 @@ void JA_audioManager::shutdown_message(const char * msg, void* arg)
 
 JA_audioManager::JA_audioManager(shutdown_callback cb, void* arg): AudioManager(cb, arg)
 {
-    fCurrentAudio = new JA_audioFader;
+    fCurrentAudio = new JA_audioFader(FLSettings::_Instance()->value("General/Audio/Jack/SharedClient", false).toBool());
     fCurrentAudio->setShutdownCallback(cb, arg);
 }
 
@@ -74,14 +75,22 @@ bool JA_audioManager::init_FadeAudio(QString& error, const char* name, dsp* DSP)
 //Crossfade start
 void JA_audioManager::start_Fade()
 {
+    fCurrentAudio->set_FadeParameters(fFadeDuration, fFadeCurve, getSampleRate());
+    
     fCurrentAudio->launch_fadeOut();
 }
 
 //When the crossfade ends, the DSP is updated in jackaudio Fader
-void JA_audioManager::wait_EndFade()
+bool JA_audioManager::end_Fade(bool force)
 {
-    while (fCurrentAudio->get_FadeOut()) {}
+    if (fCurrentAudio->get_FadeOut()) {
+        if (!force) {
+            return false;
+        }
+        fCurrentAudio->force_stopFade();
+    }
     fCurrentAudio->upDate_DSP();
+    return true;
 }
 
 //Recall Connections from saved file
@@ -118,3 +127,15 @@ int JA_audioManager::getSampleRate()
 {
     return fCurrentAudio->getSampleRate();
 }
+
+//The windows poll their load every second : the graph of the shared client follows the connections made by other JACK clients
+void JA_audioManager::get_Load(AudioLoad& load)
+{
+    fCurrentAudio->refresh_Graph();
+    fCurrentAudio->get_Load(load);
+}
+
+bool JA_audioManager::isSharedClient()
+{
+    return fCurrentAudio->isShared();
+}
@@ -41,16 +41,20 @@ class JA_audioManager : public AudioManager {
         
         virtual bool init_FadeAudio(QString& error, const char* name, dsp* DSP);
         virtual void start_Fade();
-        virtual void wait_EndFade();
+        virtual bool end_Fade(bool force);
         
         virtual void connect_Audio(string homeDir);
         virtual void save_Connections(string homeDir);
 
         virtual int getBufferSize();
         virtual int getSampleRate();
+        virtual void get_Load(AudioLoad& load);
         
         // Needed to give 'jackaudio_midi = midi_handler' object to MidiUI interface
         JA_audioFader* getAudioFader() { return fCurrentAudio; }
+    
+        // The shared client has no MIDI ports : the windows use RtMidi
+        bool isSharedClient();
 };
 
 #endif
@@ -16,6 +16,9 @@ JA_audioSettings::JA_audioSettings(QGroupBox* parent) : AudioSettings(parent)
     layout->addRow(new QLabel(tr("Auto-Connection")), fAutoConnectBox);
     fAutoStartBox = new QCheckBox(parent);
     layout->addRow(new QLabel(tr("Auto-Start")), fAutoStartBox);
+    fSharedClientBox = new QCheckBox(parent);
+    fSharedClientBox->setToolTip(tr("All the windows share one JACK client, computed by a pool of threads"));
+    layout->addRow(new QLabel(tr("Single Client")), fSharedClientBox);
     parent->setLayout(layout);
     setVisualSettings();
 }
@@ -27,17 +30,21 @@ void JA_audioSettings::setVisualSettings()
 {
     fAutoConnectBox->setChecked(FLSettings::_Instance()->value("General/Audio/Jack/AutoConnect", true).toBool());
     fAutoStartBox->setChecked(FLSettings::_Instance()->value("General/Audio/Jack/AutoStart", true).toBool());
+    fSharedClientBox->setChecked(FLSettings::_Instance()->value("General/Audio/Jack/SharedClient", false).toBool());
 }
 
 void JA_audioSettings::storeVisualSettings()
 {
     FLSettings::_Instance()->setValue("General/Audio/Jack/AutoConnect", get_AutoConnect());
     FLSettings::_Instance()->setValue("General/Audio/Jack/AutoStart", get_AutoStart());
+    FLSettings::_Instance()->setValue("General/Audio/Jack/SharedClient", get_SharedClient());
 }
 
-bool JA_audioSettings::isEqual(AudioSettings*)
+//Switching the single client mode recreates the audio of the windows
+bool JA_audioSettings::isEqual(AudioSettings* as)
 {
-    return true;
+    JA_audioSettings* settings = dynamic_cast<JA_audioSettings*>(as);
+    return (settings && settings->get_SharedClient() == get_SharedClient());
 }
 
 bool JA_audioSettings::get_AutoConnect()
@@ -50,6 +57,11 @@ bool JA_audioSettings::get_AutoStart()
     return fAutoStartBox->isChecked();
 }
 
+bool JA_audioSettings::get_SharedClient()
+{
+    return fSharedClientBox->isChecked();
+}
+
 QString JA_audioSettings::get_ArchiName()
 {
     return "JACK";
@@ -19,8 +19,10 @@ class JA_audioSettings : public AudioSettings {
 
         QCheckBox*     fAutoConnectBox;
         QCheckBox*     fAutoStartBox;
+        QCheckBox*     fSharedClientBox;
         bool           get_AutoConnect();
         bool           get_AutoStart();
+        bool           get_SharedClient();
     
     public:
     
@@ -0,0 +1,570 @@
+//
+//  JA_sharedClient.cpp
+//
+//  This file is part of FaustLive, released under the GNU General Public License version 3 (see GPL.txt).
+//
+
+#include <stdio.h>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string.h>
+#include <thread>
+
+#include "JA_sharedClient.h"
+#include "JA_audioFader.h"
+#include "FLSettings.h"
+
+JA_sharedClient* JA_sharedClient::_currentClient = NULL;
+
+JA_sharedClient::JA_sharedClient()
+{
+    fClient = NULL;
+    fRefCount = 0;
+    fShutdown = false;
+    fGraph = new sharedGraph();
+    fGraphDirty = false;
+    fCycleGraph = NULL;
+    fCycleFrames = 0;
+    fCycle = 0;
+    fReadyHead = 0;
+    fReadyTail = 0;
+    fPendingFaders = 0;
+    fRunning = false;
+    fXruns = 0;
+    fReportedXruns = 0;
+    
+    for (int i = 0; i < kMaxSharedFaders; i++) {
+        fReady[i] = 0;
+        fNodePending[i] = 0;
+    }
+}
+
+JA_sharedClient::~JA_sharedClient()
+{
+    close();
+    delete fGraph.load();
+    for (size_t i = 0; i < fRetiredGraphs.size(); i++) {
+        delete fRetiredGraphs[i];
+    }
+}
+//------------------------ CLIENT LIFE -------------------------------
+
+JA_sharedClient* JA_sharedClient::acquire()
+{
+    if (!_currentClient || _currentClient->fShutdown) {
+
+        JA_sharedClient* client = new JA_sharedClient();
+
+        if (!client->open()) {
+            delete client;
+            return NULL;
+        }
+
+        // A client that was shut down is deleted when its last fader releases it
+        _currentClient = client;
+    }
+
+    _currentClient->fRefCount++;
+    return _currentClient;
+}
+
+void JA_sharedClient::release()
+{
+    if (--fRefCount == 0) {
+        if (_currentClient == this) {
+            _currentClient = NULL;
+        }
+        delete this;
+    }
+}
+
+bool JA_sharedClient::open()
+{
+    jack_status_t status;
+    fClient = jack_client_open(kSharedClientName, JackNullOption, &status);
+
+    if (!fClient) {
+        fprintf(stderr, "Cannot open the shared JACK client, status = %x\n", status);
+        return false;
+    }
+
+    jack_set_process_callback(fClient, _process, this);
+    jack_set_buffer_size_callback(fClient, _buffersize, this);
+    jack_set_xrun_callback(fClient, _xrun, this);
+    jack_set_port_connect_callback(fClient, _portconnect, this);
+    jack_on_info_shutdown(fClient, _shutdown, this);
+
+    if (jack_activate(fClient)) {
+        fprintf(stderr, "Cannot activate the shared JACK client\n");
+        jack_client_close(fClient);
+        fClient = NULL;
+        return false;
+    }
+
+    startWorkers();
+    return true;
+}
+
+void JA_sharedClient::close()
+{
+    if (fClient) {
+        stopWorkers();
+        jack_deactivate(fClient);
+        jack_client_close(fClient);
+        fClient = NULL;
+    }
+}
+
+//General/Audio/Jack/SharedClientThreads : number of threads helping the process thread, -1 = one per additional core
+void JA_sharedClient::startWorkers()
+{
+    int numWorkers = FLSettings::_Instance()->value("General/Audio/Jack/SharedClientThreads", -1).toInt();
+
+    if (numWorkers < 0) {
+        numWorkers = int(std::thread::hardware_concurrency()) - 1;
+    }
+    numWorkers = std::max(0, std::min(numWorkers, kMaxSharedWorkers));
+
+    fRunning = true;
+
+    for (int i = 0; i < numWorkers; i++) {
+        jack_native_thread_t thread;
+        if (jack_client_create_thread(fClient, &thread, jack_client_real_time_priority(fClient), jack_is_realtime(fClient), _worker, this) == 0) {
+            fWorkers.push_back(thread);
+        } else {
+            fprintf(stderr, "Cannot create the JACK worker thread %d\n", i);
+            break;
+        }
+    }
+}
+
+//Each worker is woken up once more to see that it has to stop
+void JA_sharedClient::stopWorkers()
+{
+    fRunning = false;
+
+    for (size_t i = 0; i < fWorkers.size(); i++) {
+        fWorkSemaphore.post();
+    }
+    for (size_t i = 0; i < fWorkers.size(); i++) {
+        jack_client_stop_thread(fClient, fWorkers[i]);
+    }
+
+    fWorkers.clear();
+}
+
+//------------------------ FADERS GRAPH ------------------------------
+
+bool JA_sharedClient::addFader(JA_audioFader* fader)
+{
+    if (std::find(fFaders.begin(), fFaders.end(), fader) != fFaders.end()) {
+        return true;
+    }
+    
+    if (fFaders.size() >= kMaxSharedFaders) {
+        fprintf(stderr, "The shared JACK client cannot compute more than %d windows\n", kMaxSharedFaders);
+        return false;
+    }
+
+    fFaders.push_back(fader);
+    publish(buildGraph());
+
+    fShutdownMutex.Lock();
+    fShutdownFaders.push_back(fader);
+    fShutdownMutex.Unlock();
+    
+    return true;
+}
+
+void JA_sharedClient::removeFader(JA_audioFader* fader)
+{
+    std::vector<JA_audioFader*>::iterator it = std::find(fFaders.begin(), fFaders.end(), fader);
+
+    if (it == fFaders.end()) {
+        return;
+    }
+
+    fFaders.erase(it);
+    publish(buildGraph());
+
+    fShutdownMutex.Lock();
+    fShutdownFaders.remove(fader);
+    fShutdownMutex.Unlock();
+}
+
+void JA_sharedClient::updateGraph()
+{
+    if (!fShutdown) {
+        publish(buildGraph());
+    }
+}
+
+void JA_sharedClient::refreshGraph()
+{
+    if (fGraphDirty.exchange(false)) {
+        updateGraph();
+    }
+}
+
+//The edges are read from the JACK connections of the ports, i.e. the FJUI files recalled by the windows and the changes made since.
+//An input also connected to another client is read from JACK : the windows reach it one cycle later, as with separate clients.
+sharedGraph* JA_sharedClient::buildGraph()
+{
+    sharedGraph* graph = new sharedGraph();
+    graph->fFrames = jack_get_buffer_size(fClient);
+    
+    int numNodes = int(fFaders.size());
+    graph->fNodes.resize(numNodes);
+    
+    std::map<std::string, std::pair<int, int> > outputs;
+    
+    for (int k = 0; k < numNodes; k++) {
+        graph->fNodes[k].fFader = fFaders[k];
+        graph->fNodes[k].fNumPredecessors = 0;
+        
+        for (size_t m = 0; m < fFaders[k]->fOutputPorts.size(); m++) {
+            outputs[jack_port_name(fFaders[k]->fOutputPorts[m])] = std::make_pair(k, int(m));
+        }
+    }
+    
+    std::vector<std::set<int> > predecessors(numNodes);
+    
+    for (int n = 0; n < numNodes; n++) {
+        
+        sharedNode& node = graph->fNodes[n];
+        size_t numInputs = fFaders[n]->fInputPorts.size();
+        
+        node.fSources.resize(numInputs);
+        node.fMixBuffers.resize(numInputs);
+        node.fInputs.assign(numInputs, NULL);
+        
+        for (size_t i = 0; i < numInputs; i++) {
+            
+            const char** connections = jack_port_get_all_connections(fClient, fFaders[n]->fInputPorts[i]);
+            
+            if (!connections) {
+                continue;
+            }
+            
+            std::vector<std::pair<int, int> > sources;
+            bool external = false;
+            
+            for (int c = 0; connections[c]; c++) {
+                std::map<std::string, std::pair<int, int> >::iterator it = outputs.find(connections[c]);
+                
+                if (it == outputs.end()) {
+                    external = true;
+                } else {
+                    sources.push_back(it->second);
+                }
+            }
+            jack_free(connections);
+            
+            if (!external) {
+                node.fSources[i] = sources;
+                for (size_t s = 0; s < sources.size(); s++) {
+                    predecessors[n].insert(sources[s].first);
+                }
+            }
+        }
+    }
+    
+    //Topological sort : the windows left belong to a feedback loop or follow one
+    std::vector<int> inDegree(numNodes);
+    std::vector<std::vector<int> > successors(numNodes);
+    std::vector<int> sorted;
+    
+    for (int n = 0; n < numNodes; n++) {
+        inDegree[n] = int(predecessors[n].size());
+        for (std::set<int>::iterator it = predecessors[n].begin(); it != predecessors[n].end(); it++) {
+            successors[*it].push_back(n);
+        }
+        if (inDegree[n] == 0) {
+            sorted.push_back(n);
+        }
+    }
+    
+    for (size_t i = 0; i < sorted.size(); i++) {
+        for (size_t s = 0; s < successors[sorted[i]].size(); s++) {
+            if (--inDegree[successors[sorted[i]][s]] == 0) {
+                sorted.push_back(successors[sorted[i]][s]);
+            }
+        }
+    }
+    
+    std::vector<bool> isSorted(numNodes, false);
+    for (size_t i = 0; i < sorted.size(); i++) {
+        isSorted[sorted[i]] = true;
+    }
+    
+    //Their inputs fed by another window left are read from JACK, which breaks the loops
+    for (int n = 0; n < numNodes; n++) {
+        
+        if (isSorted[n]) {
+            continue;
+        }
+        
+        sharedNode& node = graph->fNodes[n];
+        predecessors[n].clear();
+        
+        for (size_t i = 0; i < node.fSources.size(); i++) {
+            
+            bool loop = false;
+            for (size_t s = 0; s < node.fSources[i].size(); s++) {
+                loop |= !isSorted[node.fSources[i][s].first];
+            }
+            
+            if (loop) {
+                node.fSources[i].clear();
+            }
+            for (size_t s = 0; s < node.fSources[i].size(); s++) {
+                predecessors[n].insert(node.fSources[i][s].first);
+            }
+        }
+    }
+    
+    for (int n = 0; n < numNodes; n++) {
+        
+        sharedNode& node = graph->fNodes[n];
+        node.fNumPredecessors = int(predecessors[n].size());
+        
+        for (std::set<int>::iterator it = predecessors[n].begin(); it != predecessors[n].end(); it++) {
+            graph->fNodes[*it].fSuccessors.push_back(n);
+        }
+        if (node.fNumPredecessors == 0) {
+            graph->fRoots.push_back(n);
+        }
+        
+        for (size_t i = 0; i < node.fSources.size(); i++) {
+            if (node.fSources[i].size() > 1) {
+                node.fMixBuffers[i].assign(graph->fFrames, 0.f);
+            }
+        }
+    }
+    
+    return graph;
+}
+
+//The cycle running when the graph is replaced may still use the previous one : it is deleted once the next cycle is over
+//If no cycle ended in time, the replaced graphs are kept until a next publication sees one
+void JA_sharedClient::publish(sharedGraph* graph)
+{
+    fRetiredGraphs.push_back(fGraph.exchange(graph));
+
+    // The process callback is not called anymore once the server is shut down
+    if (fShutdown || !fQuiescence.wait(kQuiescenceTimeOut)) {
+        return;
+    }
+
+    for (size_t i = 0; i < fRetiredGraphs.size(); i++) {
+        delete fRetiredGraphs[i];
+    }
+    fRetiredGraphs.clear();
+}
+
+//------------------------ AUDIO THREADS -----------------------------
+
+//A node is pushed once per cycle : the queue never holds more than kMaxSharedFaders entries
+void JA_sharedClient::pushReady(int node)
+{
+    uint64_t tail = fReadyTail.fetch_add(1);
+    fReady[uint32_t(tail)] = (tail & 0xFFFFFFFF00000000ULL) | uint32_t(node);
+}
+
+bool JA_sharedClient::popReady(int& node)
+{
+    while (true) {
+        uint64_t head = fReadyHead;
+        uint64_t tail = fReadyTail;
+        
+        // The queue is empty or is being reset for the next cycle
+        if ((head >> 32) != (tail >> 32) || uint32_t(head) >= uint32_t(tail)) {
+            return false;
+        }
+        
+        if (fReadyHead.compare_exchange_weak(head, head + 1)) {
+            
+            // The entry may still be written by the thread that pushed it
+            uint64_t entry;
+            while (((entry = fReady[uint32_t(head)]) >> 32) != (head >> 32)) {}
+            
+            node = int(entry & 0xFFFFFFFF);
+            return true;
+        }
+    }
+}
+
+float* JA_sharedClient::outputBuffer(const std::pair<int, int>& source)
+{
+    // The state of the window cannot be reclaimed before its next callback, in the next cycle
+    JA_audioFader::audioState* state = fCycleGraph->fNodes[source.first].fFader->fState.load();
+    
+    if (source.second < int(state->fOutputPorts.size())) {
+        return (float*)jack_port_get_buffer(state->fOutputPorts[source.second], fCycleFrames);
+    } else {
+        return NULL;
+    }
+}
+
+//An input fed by a single window is given its output buffer as is, the others are mixed in the node buffers
+void JA_sharedClient::computeNode(int index)
+{
+    sharedNode& node = fCycleGraph->fNodes[index];
+    
+    for (size_t i = 0; i < node.fSources.size(); i++) {
+        
+        const std::vector<std::pair<int, int> >& sources = node.fSources[i];
+        
+        if (sources.empty() || (sources.size() > 1 && fCycleFrames > fCycleGraph->fFrames)) {
+            node.fInputs[i] = NULL;
+        } else if (sources.size() == 1) {
+            node.fInputs[i] = outputBuffer(sources[0]);
+        } else {
+            float* mix = &node.fMixBuffers[i][0];
+            memset(mix, 0, fCycleFrames * sizeof(float));
+            
+            for (size_t s = 0; s < sources.size(); s++) {
+                float* output = outputBuffer(sources[s]);
+                if (output) {
+                    for (jack_nframes_t f = 0; f < fCycleFrames; f++) {
+                        mix[f] += output[f];
+                    }
+                }
+            }
+            node.fInputs[i] = mix;
+        }
+    }
+    
+    node.fFader->compute_Shared(fCycleFrames, node.fInputs.empty() ? NULL : &node.fInputs[0], int(node.fInputs.size()));
+    
+    int ready = 0;
+    for (size_t s = 0; s < node.fSuccessors.size(); s++) {
+        if (--fNodePending[node.fSuccessors[s]] == 0) {
+            pushReady(node.fSuccessors[s]);
+            ready++;
+        }
+    }
+    
+    // This thread goes on with one of them, the workers are woken up for the others
+    int numHelpers = std::min(ready - 1, int(fWorkers.size()));
+    for (int i = 0; i < numHelpers; i++) {
+        fWorkSemaphore.post();
+    }
+    
+    fPendingFaders--;
+}
+
+//The process thread stays until the cycle is over, the workers leave when no node is ready
+void JA_sharedClient::computeNodes(bool untilDone)
+{
+    while (fPendingFaders > 0) {
+        int node;
+        if (popReady(node)) {
+            computeNode(node);
+        } else if (!untilDone) {
+            return;
+        }
+    }
+}
+
+int JA_sharedClient::_process(jack_nframes_t nframes, void* arg)
+{
+    JA_sharedClient* client = static_cast<JA_sharedClient*>(arg);
+    sharedGraph* graph = client->fGraph.load();
+    int numNodes = int(graph->fNodes.size());
+
+    // The xruns are reported to the windows from the process thread, where the faders are safe to use
+    int xruns = client->fXruns;
+    if (xruns != client->fReportedXruns) {
+        for (int i = 0; i < numNodes; i++) {
+            graph->fNodes[i].fFader->fLoadMeter.add_Xrun();
+        }
+        client->fReportedXruns = xruns;
+    }
+
+    if (numNodes > 0) {
+
+        client->fCycleGraph = graph;
+        client->fCycleFrames = nframes;
+        client->fPendingFaders = numNodes;
+        
+        for (int i = 0; i < numNodes; i++) {
+            client->fNodePending[i] = graph->fNodes[i].fNumPredecessors;
+        }
+        
+        uint64_t cycle = uint64_t(++client->fCycle) << 32;
+        int numRoots = int(graph->fRoots.size());
+        
+        for (int i = 0; i < numRoots; i++) {
+            client->fReady[i] = cycle | uint32_t(graph->fRoots[i]);
+        }
+        client->fReadyTail = cycle | uint32_t(numRoots);
+        client->fReadyHead = cycle;
+
+        int numHelpers = std::min(int(client->fWorkers.size()), numRoots - 1);
+        for (int i = 0; i < numHelpers; i++) {
+            client->fWorkSemaphore.post();
+        }
+
+        client->computeNodes(true);
+    }
+
+    client->fQuiescence.end_Callback();
+    return 0;
+}
+
+void* JA_sharedClient::_worker(void* arg)
+{
+    JA_sharedClient* client = static_cast<JA_sharedClient*>(arg);
+
+    while (true) {
+        client->fWorkSemaphore.wait();
+        
+        if (!client->fRunning) {
+            break;
+        }
+        client->computeNodes(false);
+    }
+
+    return NULL;
+}
+
+//Called between two cycles by the process thread
+int JA_sharedClient::_buffersize(jack_nframes_t nframes, void* arg)
+{
+    JA_sharedClient* client = static_cast<JA_sharedClient*>(arg);
+    sharedGraph* graph = client->fGraph.load();
+
+    for (size_t i = 0; i < graph->fNodes.size(); i++) {
+        JA_audioFader::_jack_buffersize_fader(nframes, graph->fNodes[i].fFader);
+    }
+    
+    // The mix buffers are resized with the next graph, they are read from JACK meanwhile
+    client->fGraphDirty = true;
+    return 0;
+}
+
+int JA_sharedClient::_xrun(void* arg)
+{
+    static_cast<JA_sharedClient*>(arg)->fXruns++;
+    return 0;
+}
+
+//Notification thread : the graph is rebuilt in the GUI thread
+void JA_sharedClient::_portconnect(jack_port_id_t, jack_port_id_t, int, void* arg)
+{
+    static_cast<JA_sharedClient*>(arg)->fGraphDirty = true;
+}
+
+void JA_sharedClient::_shutdown(jack_status_t, const char* reason, void* arg)
+{
+    JA_sharedClient* client = static_cast<JA_sharedClient*>(arg);
+    client->fShutdown = true;
+
+    client->fShutdownMutex.Lock();
+    for (std::list<JA_audioFader*>::iterator it = client->fShutdownFaders.begin(); it != client->fShutdownFaders.end(); it++) {
+        (*it)->shutdown_Shared(reason);
+    }
+    client->fShutdownMutex.Unlock();
+}
@@ -0,0 +1,139 @@
+//
+//  JA_sharedClient.h
+//
+//  This file is part of FaustLive, released under the GNU General Public License version 3 (see GPL.txt).
+//
+
+// In "single client" mode (General/Audio/Jack/SharedClient), the windows do not open their own JACK client anymore.
+// Their JA_audioFader registers its ports on the client shared by the application, which computes all the faders in one process callback.
+//
+// The faders form a graph : a window whose inputs are only connected to the outputs of other windows (the connections recalled
+// from the FJUI files or made afterwards) is computed after them in the same cycle, reading their output buffers directly.
+// The windows that do not depend on each other are spread over a pool of JACK realtime threads.
+
+#ifndef _JA_sharedClient_h
+#define _JA_sharedClient_h
+
+#include <atomic>
+#include <list>
+#include <utility>
+#include <vector>
+#include <jack/jack.h>
+#include <jack/thread.h>
+
+#include "AudioFader_Implementation.h"
+#include "TMutex.h"
+
+#define kSharedClientName   "FaustLive"
+#define kMaxSharedWorkers   16
+#define kMaxSharedFaders    256
+
+class JA_audioFader;
+
+// A window of the graph
+struct sharedNode {
+    
+    JA_audioFader*      fFader;
+    
+    //For each input port connected to windows only : their (node, output port). Empty when the input is read from JACK
+    std::vector<std::vector<std::pair<int, int> > > fSources;
+    std::vector<std::vector<float> > fMixBuffers;   // Inputs fed by several outputs
+    std::vector<float*> fInputs;                    // Buffers given to the fader, set by the thread computing the node
+    
+    std::vector<int>    fSuccessors;
+    int                 fNumPredecessors;
+};
+
+struct sharedGraph {
+    
+    std::vector<sharedNode> fNodes;
+    std::vector<int>        fRoots;
+    jack_nframes_t          fFrames;    // Size of the mix buffers
+};
+
+class JA_sharedClient
+{
+    private:
+
+        static JA_sharedClient* _currentClient;
+
+        jack_client_t*          fClient;
+        int                     fRefCount;      // Faders using the client, handled in the GUI thread
+        std::atomic<bool>       fShutdown;
+
+    //Running faders, in the GUI thread
+        std::vector<JA_audioFader*> fFaders;
+    
+    //The graph is replaced as a whole and the previous one is deleted once the audio thread is done with it
+        std::atomic<sharedGraph*> fGraph;
+        std::vector<sharedGraph*> fRetiredGraphs;   // Replaced graphs that a cycle may still be using, GUI thread
+        AudioFader_Quiescence   fQuiescence;    // Acknowledges the end of each process callback
+        std::atomic<bool>       fGraphDirty;    // The connections changed outside FaustLive
+
+    //Faders to warn if the server shuts down (the notification does not come from the process thread)
+        TMutex                  fShutdownMutex;
+        std::list<JA_audioFader*> fShutdownFaders;
+
+    //Scheduling of a cycle : the nodes whose predecessors are computed are pushed in the ready queue,
+    //from which the process thread and the workers claim them. The cycle number is kept in the high 32 bits
+    //of the queue indexes and entries, so that a worker woken up late cannot claim a node of another cycle.
+        sharedGraph*            fCycleGraph;
+        jack_nframes_t          fCycleFrames;
+        uint32_t                fCycle;
+        std::atomic<uint64_t>   fReadyHead;
+        std::atomic<uint64_t>   fReadyTail;
+        std::atomic<uint64_t>   fReady[kMaxSharedFaders];
+        std::atomic<int>        fNodePending[kMaxSharedFaders];    // Predecessors not computed yet
+        std::atomic<int>        fPendingFaders;
+
+        std::vector<jack_native_thread_t> fWorkers;
+        AudioFader_Semaphore    fWorkSemaphore;
+        std::atomic<bool>       fRunning;
+
+        std::atomic<int>        fXruns;
+        int                     fReportedXruns; // Process thread only
+
+                                JA_sharedClient();
+        virtual                 ~JA_sharedClient();
+
+        bool                    open();
+        void                    close();
+
+        void                    startWorkers();
+        void                    stopWorkers();
+
+        sharedGraph*            buildGraph();
+        void                    publish(sharedGraph* graph);
+    
+        void                    pushReady(int node);
+        bool                    popReady(int& node);
+        float*                  outputBuffer(const std::pair<int, int>& source);
+        void                    computeNode(int node);
+        void                    computeNodes(bool untilDone);
+
+        static int              _process(jack_nframes_t nframes, void* arg);
+        static int              _buffersize(jack_nframes_t nframes, void* arg);
+        static int              _xrun(void* arg);
+        static void             _portconnect(jack_port_id_t a, jack_port_id_t b, int connect, void* arg);
+        static void             _shutdown(jack_status_t code, const char* reason, void* arg);
+        static void*            _worker(void* arg);
+
+    public:
+
+    //The client is opened by the first fader. If the server was shut down, a new one is opened : the previous one is closed with its last fader
+        static JA_sharedClient* acquire();
+        void                    release();
+
+        jack_client_t*          getClient() { return fClient; }
+
+    //Once removeFader returns, the audio thread does not use the fader anymore
+        bool                    addFader(JA_audioFader* fader);
+        void                    removeFader(JA_audioFader* fader);
+    
+    //To be called when the ports or the connections of a fader change
+        void                    updateGraph();
+    //Rebuilds the graph if the connections were changed by another JACK client
+        void                    refreshGraph();
+};
+
+#endif
@@ -57,8 +57,10 @@ void NJm_audioFader::process(int count, float** audio_inputs, float** audio_outp
     decodeMidiControl(midi_inputs[0], fResult.buffer_size);
     
     // "count" may be less than buffer_size
+    fLoadMeter.begin_Period();
     fDSP->compute(count, inputs_tmp, outputs_tmp);
     crossfade_Calcul(count, fDSP->getNumOutputs(), outputs_tmp);
+    fLoadMeter.end_Period(count, fResult.sample_rate);
     
     // Control buffer always use buffer_size, even if uncomplete data buffer (count < buffer_size) is received
     encodeMidiControl(midi_outputs[0], fResult.buffer_size);
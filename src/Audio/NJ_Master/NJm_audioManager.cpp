@@ -96,17 +96,21 @@ bool NJm_audioManager::init_FadeAudio(QString& error, const char* name, dsp* DSP
 //Crossfade start
 void NJm_audioManager::start_Fade()
 {
+    fCurrentAudio->set_FadeParameters(fFadeDuration, fFadeCurve, getSampleRate());
+    fFadeInAudio->set_FadeParameters(fFadeDuration, fFadeCurve, getSampleRate());
+    
     fCurrentAudio->launch_fadeOut();
     fFadeInAudio->launch_fadeIn();
     fFadeInAudio->start();
 }
 
 //When the crossfade ends, FadeInAudio becomes the current audio 
-void NJm_audioManager::wait_EndFade()
+bool NJm_audioManager::end_Fade(bool force)
 {
-    QDateTime currentTime(QDateTime::currentDateTime());
-    
-    while (fCurrentAudio->get_FadeOut()) {
+    if (fCurrentAudio->get_FadeOut()) {
+        if (!force) {
+            return false;
+        }
         fFadeInAudio->force_stopFade();
         fCurrentAudio->force_stopFade();
     }
@@ -116,6 +120,7 @@ void NJm_audioManager::wait_EndFade()
     fCurrentAudio = fFadeInAudio;
     fFadeInAudio = intermediate;
     delete fFadeInAudio;
+    return true;
 }
 
 //In case of Network failure, the application is notified
@@ -134,6 +139,11 @@ int NJm_audioManager::getSampleRate()
     return fCurrentAudio->getSampleRate();
 }
 
+void NJm_audioManager::get_Load(AudioLoad& load)
+{
+    fCurrentAudio->get_Load(load);
+}
+
 bool NJm_audioManager::isConnexionActive()
 {
     return fCurrentAudio->isConnexionActive();
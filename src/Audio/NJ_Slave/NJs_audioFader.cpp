@@ -40,8 +40,10 @@ int NJs_audioFader::restart_cb()
 void NJs_audioFader::process(int count,  float** inputs, float** outputs)
 {
      AVOIDDENORMALS;
+     fLoadMeter.begin_Period();
      fDSP->compute(count, inputs, outputs);
      crossfade_Calcul(count, fDSP->getNumOutputs(), outputs);
+     fLoadMeter.end_Period(count, fResult.sample_rate);
 }
 
 bool NJs_audioFader::init(const char* name, dsp* DSP) 
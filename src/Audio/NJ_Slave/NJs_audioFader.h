@@ -61,7 +61,7 @@ class NJs_audioFader : public QObject, public netjackaudio, public AudioFader_In
         virtual void launch_fadeIn();
         virtual void launch_fadeOut();
         virtual bool get_FadeOut();
-        void force_stopFade();
+        virtual void force_stopFade();
     
     signals:
     
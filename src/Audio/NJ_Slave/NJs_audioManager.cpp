@@ -102,17 +102,21 @@ bool NJs_audioManager::init_FadeAudio(QString& error, const char* name, dsp* DSP
 //Crossfade start
 void NJs_audioManager::start_Fade()
 {
+    fCurrentAudio->set_FadeParameters(fFadeDuration, fFadeCurve, getSampleRate());
+    fFadeInAudio->set_FadeParameters(fFadeDuration, fFadeCurve, getSampleRate());
+    
     fCurrentAudio->launch_fadeOut();
     fFadeInAudio->launch_fadeIn();
     fFadeInAudio->start();
 }
 
 //When the crossfade ends, FadeInAudio becomes the current audio 
-void NJs_audioManager::wait_EndFade()
+bool NJs_audioManager::end_Fade(bool force)
 {
-    QDateTime currentTime(QDateTime::currentDateTime());
-    
-    while(fCurrentAudio->get_FadeOut() == 1){
+    if (fCurrentAudio->get_FadeOut()) {
+        if (!force) {
+            return false;
+        }
         fFadeInAudio->force_stopFade();
         fCurrentAudio->force_stopFade();
     }
@@ -122,6 +126,7 @@ void NJs_audioManager::wait_EndFade()
     fCurrentAudio = fFadeInAudio;
     fFadeInAudio = intermediate;
     delete fFadeInAudio;
+    return true;
 }
 
 //In case of Network failure, the application is notified
@@ -140,4 +145,9 @@ int NJs_audioManager::getSampleRate()
     return fCurrentAudio->getSampleRate();
 }
 
+void NJs_audioManager::get_Load(AudioLoad& load)
+{
+    fCurrentAudio->get_Load(load);
+}
+
 
@@ -52,10 +52,11 @@ class NJs_audioManager : public AudioManager {
     
         virtual bool init_FadeAudio(QString& error, const char* name, dsp* DSP);
         virtual void start_Fade();
-        virtual void wait_EndFade();
+        virtual bool end_Fade(bool force);
     
         virtual int getBufferSize();
         virtual int getSampleRate();
+        virtual void get_Load(AudioLoad& load);
     
     private slots:
     
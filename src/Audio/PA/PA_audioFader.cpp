@@ -21,8 +21,10 @@ PA_audioFader::~PA_audioFader() {}
 int PA_audioFader::processAudio(PaTime current_time, float** ibuf, float** obuf, unsigned long frames) 
 {
     // Process samples
+    fLoadMeter.begin_Period();
     fDsp->compute(current_time * 1000000., frames, ibuf, obuf);
     crossfade_Calcul(frames, fDevNumOutChans, obuf);
+    fLoadMeter.end_Period(frames, fSampleRate);
 	return paContinue;
 }
 
@@ -42,3 +44,8 @@ bool PA_audioFader::get_FadeOut()
 {
     return get_doWeFadeOut();
 }
+
+void PA_audioFader::force_stopFade()
+{
+    reset_Values();
+}
@@ -33,7 +33,7 @@ class PA_audioFader : public portaudio, public AudioFader_Interface, public Audi
         virtual void launch_fadeIn();
         virtual bool get_FadeOut();
     
-        void force_stopFade();
+        virtual void force_stopFade();
     
 };
 
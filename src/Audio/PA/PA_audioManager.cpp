@@ -96,20 +96,30 @@ bool PA_audioManager::init_FadeAudio(QString& error, const char* name, dsp* DSP)
 //Crossfade start
 void PA_audioManager::start_Fade()
 {
+    fFadeInAudio->set_FadeParameters(fFadeDuration, fFadeCurve, getSampleRate());
+    fCurrentAudio->set_FadeParameters(fFadeDuration, fFadeCurve, getSampleRate());
+    
     fFadeInAudio->launch_fadeIn();
     fCurrentAudio->launch_fadeOut();
     fFadeInAudio->start();
 }
 
 //When the crossfade ends, the DSP is updated in jackaudio Fader
-void PA_audioManager::wait_EndFade()
+bool PA_audioManager::end_Fade(bool force)
 {
-    while (fCurrentAudio->get_FadeOut()) {}
+    if (fCurrentAudio->get_FadeOut()) {
+        if (!force) {
+            return false;
+        }
+        fFadeInAudio->force_stopFade();
+        fCurrentAudio->force_stopFade();
+    }
     fCurrentAudio->stop();
     PA_audioFader* intermediate = fCurrentAudio;
     fCurrentAudio = fFadeInAudio;
     fFadeInAudio = intermediate;
     delete fFadeInAudio;
+    return true;
 }
 
 int PA_audioManager::getBufferSize()
@@ -122,4 +132,9 @@ int PA_audioManager::getSampleRate()
     return fCurrentAudio->getSampleRate();
 }
 
+void PA_audioManager::get_Load(AudioLoad& load)
+{
+    fCurrentAudio->get_Load(load);
+}
+
 
@@ -16,6 +16,8 @@
 #include <QDir>
 
 #include "FLServerHttp.h"
+#include "FLOscServer.h"
+#include "FLOscBundler.h"
 #include "FLApp.h"
 
 #ifdef _WIN32
@@ -23,7 +25,9 @@
 #endif
 
 #include "FLSessionManager.h"
+#include "FLFactoryCompiler.h"
 #include "FLInterfaceManager.h"
+#include "FLCompileStats.h"
 #include "FLWindow.h"
 #include "FLComponentWindow.h"
 #include "FLErrorWindow.h"
@@ -52,10 +56,13 @@ FLApp::FLApp(int& argc, char** argv) : QApplication(argc, argv){
     
     FLSettings::createInstance(fSessionFolder);
     FLSessionManager::createInstance(fSessionFolder);
+    
+    //Factories can be compiled in a separate thread, their warnings are printed here
+    connect(FLSessionManager::_Instance(), SIGNAL(error(const QString&)), this, SLOT(errorPrinting(const QString&)));
 
     //Connect drop on the HTML interface to the application action
     FLServerHttp::createInstance(fHtmlFolder.toStdString());
-    connect(FLServerHttp::_Instance(), SIGNAL(compile(const char*, int)), this, SLOT(compile_HttpData(const char*, int)));
+    connect(FLServerHttp::_Instance(), SIGNAL(compile(const QString&, int, const QString&, int)), this, SLOT(compile_HttpData(const QString&, int, const QString&, int)));
 
 #ifdef REMOTE
     fDSPServer = createRemoteDSPServer(0, NULL);
@@ -136,9 +143,16 @@ FLApp::FLApp(int& argc, char** argv) : QApplication(argc, argv){
     connect(fInitTimer, SIGNAL(timeout()), this, SLOT(init_Timer_Action()));
     fInitTimer->start(500);
     
+    //Only the windows which zones changed are refreshed, see FLInterfaceManager
+    int refreshRate = FLSettings::_Instance()->value("General/Control/GuiRefreshRate", kGuiRefreshRate).toInt();
+    if (refreshRate <= 0) {
+        refreshRate = kGuiRefreshRate;
+    }
+    FLInterfaceManager::_Instance()->setRefreshRates(refreshRate, FLSettings::_Instance()->value("General/Control/HiddenGuiRefreshRate", kHiddenGuiRefreshRate).toInt());
+    
     QTimer* updateGuiTimer = new QTimer(this);
     QObject::connect(updateGuiTimer, SIGNAL(timeout()), this, SLOT(updateGuis()));
-    updateGuiTimer->start(100);
+    updateGuiTimer->start(refreshRate);
 }
 
 FLApp::~FLApp(){
@@ -163,12 +177,19 @@ FLApp::~FLApp(){
     
     FLHelpWindow::deleteInstance();
     
+    //Waits for the compilations still running, they read the settings
+    FLFactoryCompiler::deleteInstance();
+    
     FLSettings::deleteInstance();
 
     FLSessionManager::deleteInstance();
 
     FLServerHttp::deleteInstance();
     
+    FLOscServer::deleteInstance();
+    
+    FLOscBundler::deleteInstance();
+    
 #ifdef REMOTE
     if (fDSPServer)
         deleteRemoteDSPServer(fDSPServer);
@@ -493,6 +514,14 @@ QMenu* FLApp::create_HelpMenu()
     openFDoc->setToolTip(tr("Open Faust Documentation in appropriate application"));
     connect(openFDoc, SIGNAL(triggered()), this, SLOT(open_F_doc()));
     
+    QAction* compileStatsAction = new QAction(tr("&Compilation Statistics"), NULL);
+    compileStatsAction->setToolTip(tr("Show the duration of each phase of the last compilations"));
+    connect(compileStatsAction, SIGNAL(triggered()), this, SLOT(compileStats_Action()));
+    
+    QAction* exportCompileStatsAction = new QAction(tr("&Export Compilation Statistics..."), NULL);
+    exportCompileStatsAction->setToolTip(tr("Save the duration of each phase of the last compilations as CSV"));
+    connect(exportCompileStatsAction, SIGNAL(triggered()), this, SLOT(exportCompileStats_Action()));
+    
 //#ifndef __APPLE__
     
     QAction* aboutAction = new QAction(tr("&Help..."), NULL);
@@ -516,6 +545,9 @@ QMenu* FLApp::create_HelpMenu()
     helpMenu->addAction(openFLDoc);
     helpMenu->addAction(openFDoc);  
     helpMenu->addSeparator();
+    helpMenu->addAction(compileStatsAction);
+    helpMenu->addAction(exportCompileStatsAction);
+    helpMenu->addSeparator();
     helpMenu->addAction(versionAction);
 //#ifndef __APPLE__
     
@@ -688,10 +720,11 @@ void FLApp::connectWindowSignals(FLWindow* win)
 //---------------NEW WINDOW
 
 //--General creation function
-FLWindow* FLApp::createWindow(int index, const QString& mySource, FLWinSettings* windowSettings, QString& error)
+FLWindow* FLApp::createWindow(int index, const QString& mySource, FLWinSettings* windowSettings, QString& error, QPair<QString, void*> factorySetts)
 {
     if (FLW_List.size() >= numberWindows) {
         error = "You cannot open more windows. If you are not happy with this limit, feel free to contact us : research.grame@gmail.com ^^";
+        FLSessionManager::_Instance()->deleteFactory(factorySetts);
         return NULL;
     }
     
@@ -718,7 +751,7 @@ FLWindow* FLApp::createWindow(int index, const QString& mySource, FLWinSettings*
     
 // Initialization of the window
 // Some of its signals have to be connected to the application slots
-    if (win->init_Window(init, source, error)) {
+    if (win->init_Window(init, source, error, factorySetts)) {
         FLW_List.push_back(win);
         connectWindowSignals(win);
         fNavigateMenus[win] = navigateMenu;
@@ -815,8 +848,10 @@ void FLApp::open_New_Window()
         if ((*it) != "") {
 		    QString inter(*it);
 			fLastOpened = QFileInfo(inter).absolutePath();
+            // The default window stays default until its compilation is over : only the first file is compiled in it
             if (win != NULL && win->is_Default()) {
                 win->update_Window(inter);
+                win = NULL;
             } else {
                 create_New_Window(inter);
             }
@@ -1157,18 +1192,20 @@ void FLApp::recall_Snapshot(const QString& name, bool importOption){
     }
     
 //    Restore windows with new index
+    map<int, QString> newSources;
+    map<int, FLWinSettings*> newSettings;
+    
     for(map<int, int>::iterator it = indexChanges.begin(); it != indexChanges.end(); it++){
         
         QString windowPath = copyWindowFolder(fSessionFolder, it->second, folderName, it->first, indexChanges);
     
         QString settingPath = windowPath + "/Settings.ini";
-        FLWinSettings* windowSettings = new FLWinSettings(it->second, settingPath, QSettings::IniFormat);
-        
-        QString error;
-        if(!createWindow(it->second, restoredSources[it->first], windowSettings, error))
-            errorPrinting(error);
+        newSettings[it->second] = new FLWinSettings(it->second, settingPath, QSettings::IniFormat);
+        newSources[it->second] = restoredSources[it->first];
     }
     
+    createWindows(newSources, newSettings);
+    
 #ifndef _WIN32
     deleteDirectoryAndContent(folderName);
 #endif
@@ -1181,16 +1218,45 @@ void FLApp::recall_Snapshot(const QString& name, bool importOption){
 //--- Common function to the snapshots and the current session
 void FLApp::restoreSession( map<int, QString> restoredSources){
 
+    map<int, FLWinSettings*> restoredSettings;
+    
     map<int, QString>::iterator it;
     for(it = restoredSources.begin(); it != restoredSources.end(); it++){
         
         QString windowPath = createWindowFolder(fSessionFolder, it->first);
         
         QString settingPath = windowPath + "/Settings.ini";
-        FLWinSettings* windowSettings = new FLWinSettings(it->first, settingPath, QSettings::IniFormat);
+        restoredSettings[it->first] = new FLWinSettings(it->first, settingPath, QSettings::IniFormat);
+    }
+    
+    createWindows(restoredSources, restoredSettings);
+}
+
+//--- The factories of all the windows are compiled concurrently, then the windows and their audio are set up one after another
+void FLApp::createWindows(map<int, QString> sources, map<int, FLWinSettings*> settings){
+    
+    QList<QString> toCompile;
+    QList<FLWinSettings*> compileSettings;
+    
+    map<int, QString>::iterator it;
+    for(it = sources.begin(); it != sources.end(); it++){
+        toCompile.push_back(it->second);
+        compileSettings.push_back(settings[it->first]);
+    }
+    
+    QList<QString> errors;
+    QList<QPair<QString, void*> > factories = FLFactoryCompiler::_Instance()->compileAll(toCompile, compileSettings, errors);
+    
+    int i = 0;
+    for(it = sources.begin(); it != sources.end(); it++, i++){
         
-        QString error;
-        if(!createWindow(it->first, it->second, windowSettings, error))
+        QString error = errors[i];
+        
+        if(error != ""){
+            delete settings[it->first];
+            errorPrinting(error);
+        }
+        else if(!createWindow(it->first, it->second, settings[it->first], error, factories[i]))
             errorPrinting(error);
     }
 }
@@ -1355,6 +1421,12 @@ void FLApp::common_shutAction(FLWindow* win){
     if(path != "")
         set_Current_File(path);
     
+    //The http clients waiting for this window would never be answered
+    QMap<int, int> requests = fHttpUpdatingWindows.take(win);
+    for (QMap<int, int>::iterator it = requests.begin(); it != requests.end(); it++) {
+        FLServerHttp::_Instance()->compileFailed(it.value(), "The window was closed during the compilation");
+    }
+    
     win->shutWindow();
         
     QAction* action = fFrontWindow.key(win);
@@ -1476,6 +1548,25 @@ void FLApp::open_F_doc(){
         errorPrinting("Impossible to open Faust documentation ! Make sure a file association is set up for .pdf.");
 }
 
+//Duration of the phases of the last compilations
+void FLApp::compileStats_Action()
+{
+    errorPrinting(FLCompileStats::_Instance()->toSummary());
+}
+
+void FLApp::exportCompileStats_Action()
+{
+    QString filename = QFileDialog::getSaveFileName(NULL, tr("Export Compilation Statistics"), fLastOpened, tr("(*.csv)"));
+    
+    if (filename != "") {
+        fLastOpened = QFileInfo(filename).absolutePath();
+        
+        if (!FLCompileStats::_Instance()->writeCSV(filename)) {
+            errorPrinting("Impossible to write " + filename);
+        }
+    }
+}
+
 #ifndef LLVM_VERSION
 // best guess
 #define LLVM_VERSION "3.x"
@@ -1707,6 +1798,16 @@ FLWindow* FLApp::httpPortToWin(int port){
     return NULL;
 }
 
+/*In single port mode, they are identified by their name */
+FLWindow* FLApp::httpNameToWin(const QString& window){
+    
+    for(QList<FLWindow*>::iterator it = FLW_List.begin(); it != FLW_List.end(); it++){
+        if ((*it)->get_nameWindow() == window)
+            return *it;
+    }
+    return NULL;
+}
+
 //Start FaustLive Server that wraps HTTP interface in a droppable environnement 
 void FLApp::launch_Server(){
     
@@ -1748,7 +1849,7 @@ void FLApp::stop_Server()
 }
 
 //Update when a file is dropped on HTTP interface (it has the same behavior as a drop in FaustLive window)
-void FLApp::compile_HttpData(const char* data, int port)
+void FLApp::compile_HttpData(const QString& data, int port, const QString& window, int requestId)
 {
     FLWindow* win;
     QString source(data);
@@ -1756,7 +1857,7 @@ void FLApp::compile_HttpData(const char* data, int port)
     
     bool success = false;
     
-    if(port == 0){
+    if(port == 0 && window == ""){
         
         int val = find_smallest_index(get_currentIndexes());
         
@@ -1776,18 +1877,56 @@ void FLApp::compile_HttpData(const char* data, int port)
         if(win != NULL)
             success = true;
     } else {
-        win = httpPortToWin(port);
+        win = (window != "") ? httpNameToWin(window) : httpPortToWin(port);
         
-        if(win->update_Window(source))
-            success = true;
+        if (win != NULL) {
+            //The server is answered once the compilation is over (see httpUpdateDone)
+            connect(win, SIGNAL(updateDone(int, bool, const QString&)), this, SLOT(httpUpdateDone(int, bool, const QString&)), Qt::UniqueConnection);
+            fHttpUpdatingWindows[win][win->update_Window(source)] = requestId;
+            return;
+        }
+        
+        error = (window != "") ? ("No window is named " + window) : ("No window is listening on port " + QString::number(port));
     }
     
 //The server has to know whether the compilation is successfull, to stop blocking the answer to its client
     if (success){
         string url = win->get_HttpUrl().toStdString();
-        FLServerHttp::_Instance()->compileSuccessfull(url);
+        FLServerHttp::_Instance()->compileSuccessfull(requestId, url);
     } else {
-        FLServerHttp::_Instance()->compileFailed(error.toStdString());
+        FLServerHttp::_Instance()->compileFailed(requestId, error.toStdString());
+    }
+}
+
+//The update of a window dropped through the http server is over
+void FLApp::httpUpdateDone(int ticket, bool success, const QString& errorMsg)
+{
+    FLWindow* win = (FLWindow*)QObject::sender();
+    
+    //The window was updated from another source
+    if (!fHttpUpdatingWindows.contains(win)) {
+        return;
+    }
+    
+    //The tickets are increasing : the drops compiled before this update were superseded by it, the later ones are still compiling
+    QMap<int, int>& requests = fHttpUpdatingWindows[win];
+    QMap<int, int>::iterator it = requests.begin();
+    
+    while (it != requests.end() && it.key() <= ticket) {
+        
+        if (it.key() < ticket) {
+            FLServerHttp::_Instance()->compileSuperseded(it.value());
+        } else if (success) {
+            FLServerHttp::_Instance()->compileSuccessfull(it.value(), win->get_HttpUrl().toStdString());
+        } else {
+            FLServerHttp::_Instance()->compileFailed(it.value(), errorMsg.toStdString());
+        }
+        
+        it = requests.erase(it);
+    }
+    
+    if (requests.isEmpty()) {
+        fHttpUpdatingWindows.remove(win);
     }
 }
 
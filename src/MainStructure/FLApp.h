@@ -78,6 +78,9 @@ class FLApp : public QApplication
 //--------List of windows currently running in the application
         QList<FLWindow*>     FLW_List;       
     
+//--------Windows updated from the http server, waiting for the end of their compilation : the request to answer by update ticket
+        QMap<FLWindow*, QMap<int, int> > fHttpUpdatingWindows;
+    
 //--------Screen parameters
         int                 fScreenWidth;
         int                 fScreenHeight;
@@ -143,6 +146,7 @@ class FLApp : public QApplication
     //Functions of rehabilitation if sources disapears
         bool                recall_CurrentSession();
 		void				restoreSession(map<int, QString>);
+        void                createWindows(map<int, QString> sources, map<int, FLWinSettings*> settings);
     
     //-----------------Questions about the current State
 
@@ -164,9 +168,11 @@ class FLApp : public QApplication
    
 //--------Http Server Response
         FLWindow*           httpPortToWin(int port);
+        FLWindow*           httpNameToWin(const QString& window);
         void                changeDropPort();
         void                launch_Server();
-        void                compile_HttpData(const char* data, int port);
+        void                compile_HttpData(const QString& data, int port, const QString& window, int requestId);
+        void                httpUpdateDone(int ticket, bool success, const QString& errorMsg);
         void                stop_Server();
 
     //---------Drop on a window
@@ -181,7 +187,7 @@ class FLApp : public QApplication
     //---------File
         void                connectWindowSignals(FLWindow* win);
         void                create_Empty_Window();
-        FLWindow*           createWindow(int index, const QString& mySource, FLWinSettings* windowSettings, QString& error);
+        FLWindow*           createWindow(int index, const QString& mySource, FLWinSettings* windowSettings, QString& error, QPair<QString, void*> factorySetts = QPair<QString, void*>());
         void                open_New_Window();
         void                open_Example_From_FileMenu();
         void                open_Recent_File();
@@ -218,6 +224,8 @@ class FLApp : public QApplication
         void                open_FL_doc();
         void                open_F_doc();
         void                version_Action();
+        void                compileStats_Action();
+        void                exportCompileStats_Action();
         void                show_presentation_Action();
     
     //--------Timers
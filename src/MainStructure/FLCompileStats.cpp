@@ -0,0 +1,255 @@
+//
+//  FLCompileStats.cpp
+//
+//  This file is part of FaustLive, released under the GNU General Public License version 3 (see GPL.txt).
+//
+
+#include <QFile>
+#include <QTextStream>
+
+#include "FLCompileStats.h"
+#include "FLSessionManager.h"
+
+static const char* kPhaseNames[kPhaseNumber] = {
+    "source",
+    "expand",
+    "auxFiles",
+    "machineCodeRead",
+    "bitcodeRead",
+    "compile",
+    "bitcodeWrite",
+    "machineCodeWrite",
+    "dependencies"
+};
+
+static QString jsonString(const QString& text)
+{
+    QString escaped = text;
+    escaped.replace("\\", "\\\\");
+    escaped.replace("\"", "\\\"");
+    escaped.replace("\n", "\\n");
+    return "\"" + escaped + "\"";
+}
+
+static QString csvString(const QString& text)
+{
+    QString escaped = text;
+    escaped.replace("\"", "\"\"");
+    return "\"" + escaped + "\"";
+}
+
+static QString toMs(qint64 ns)
+{
+    return QString::number(double(ns) / 1000000., 'f', 3);
+}
+
+//The factories shared between the windows are not recorded as compilations : their cache is reported aside
+static factoryCacheStats getCacheStats()
+{
+    FLSessionManager* sessionManager = FLSessionManager::_Instance();
+    return (sessionManager) ? sessionManager->getFactoryCacheStats() : factoryCacheStats();
+}
+
+//-------------------------FLCOMPILERECORDER------------------------------
+
+FLCompileRecorder::FLCompileRecorder()
+{
+    fRecord.fDate = QDateTime::currentDateTime();
+    fTotalTimer.start();
+    fPhaseTimer.start();
+}
+
+FLCompileRecorder::~FLCompileRecorder()
+{
+    fRecord.fTotal = fTotalTimer.nsecsElapsed();
+    FLCompileStats::_Instance()->addRecord(fRecord);
+}
+
+void FLCompileRecorder::startPhase()
+{
+    fPhaseTimer.restart();
+}
+
+void FLCompileRecorder::endPhase(CompilePhase phase)
+{
+    fRecord.fPhases[phase] += fPhaseTimer.nsecsElapsed();
+}
+
+//-------------------------FLCOMPILESTATS---------------------------------
+
+FLCompileStats::FLCompileStats()
+{
+    fRecords.resize(kCompileStatsSize);
+    fNext = 0;
+    fCount = 0;
+}
+
+FLCompileStats::~FLCompileStats() {}
+
+//The recorders may be used from the compilation threads before any window is created
+FLCompileStats* FLCompileStats::_Instance()
+{
+    static FLCompileStats compileStats;
+    return &compileStats;
+}
+
+const char* FLCompileStats::phaseName(int phase)
+{
+    return (phase >= 0 && phase < kPhaseNumber) ? kPhaseNames[phase] : "";
+}
+
+void FLCompileStats::addRecord(const compileRecord& record)
+{
+    QMutexLocker locker(&fMutex);
+
+    fRecords[fNext] = record;
+    fNext = (fNext + 1) % kCompileStatsSize;
+
+    if (fCount < kCompileStatsSize) {
+        fCount++;
+    }
+}
+
+void FLCompileStats::clear()
+{
+    QMutexLocker locker(&fMutex);
+    fNext = 0;
+    fCount = 0;
+}
+
+QVector<compileRecord> FLCompileStats::getRecords()
+{
+    QMutexLocker locker(&fMutex);
+
+    QVector<compileRecord> records;
+    int first = (fNext - fCount + kCompileStatsSize) % kCompileStatsSize;
+
+    for (int i = 0; i < fCount; i++) {
+        records.push_back(fRecords[(first + i) % kCompileStatsSize]);
+    }
+
+    return records;
+}
+
+//Mean and maximum of each phase, then the last compilations
+QString FLCompileStats::toSummary()
+{
+    QVector<compileRecord> records = getRecords();
+    factoryCacheStats cache = getCacheStats();
+    
+    QString cacheSummary = "Factory cache : " + QString::number(cache.fHits) + " hits, " + QString::number(cache.fMisses) + " misses, "
+        + QString::number(cache.fEntries) + " factories, " + QString::number(cache.fIRBytes / 1024) + " KB of bitcode on disk";
+
+    if (records.isEmpty()) {
+        return "No compilation recorded\n" + cacheSummary;
+    }
+
+    qint64 sum[kPhaseNumber + 1] = {0};
+    qint64 max[kPhaseNumber + 1] = {0};
+
+    for (QVector<compileRecord>::iterator it = records.begin(); it != records.end(); it++) {
+        for (int i = 0; i < kPhaseNumber; i++) {
+            sum[i] += it->fPhases[i];
+            max[i] = qMax(max[i], it->fPhases[i]);
+        }
+        sum[kPhaseNumber] += it->fTotal;
+        max[kPhaseNumber] = qMax(max[kPhaseNumber], it->fTotal);
+    }
+
+    QString summary = "Compilation statistics (" + QString::number(records.size()) + " factories, ms mean / max) :";
+
+    for (int i = 0; i <= kPhaseNumber; i++) {
+        QString name = (i < kPhaseNumber) ? phaseName(i) : "total";
+        summary += "\n  " + name.leftJustified(18, ' ') + toMs(sum[i] / records.size()) + " / " + toMs(max[i]);
+    }
+
+    summary += "\n" + cacheSummary;
+    summary += "\nLast compilations :";
+
+    for (int i = qMax(0, records.size() - 5); i < records.size(); i++) {
+        summary += "\n  " + records[i].fDate.toString("hh:mm:ss") + "  " + records[i].fName + " (" + records[i].fTier + ") " + toMs(records[i].fTotal) + " ms";
+        if (!records[i].fSuccess) {
+            summary += " FAILED";
+        }
+    }
+
+    return summary;
+}
+
+QString FLCompileStats::toJSON()
+{
+    QVector<compileRecord> records = getRecords();
+    factoryCacheStats cache = getCacheStats();
+
+    QString json = "{\n\"capacity\": " + QString::number(kCompileStatsSize) + ",\n\"unit\": \"ms\",";
+    json += "\n\"factoryCache\": {\"hits\": " + QString::number(cache.fHits) + ", \"misses\": " + QString::number(cache.fMisses);
+    json += ", \"entries\": " + QString::number(cache.fEntries) + ", \"irBytes\": " + QString::number(cache.fIRBytes) + "},";
+    json += "\n\"records\": [";
+
+    for (QVector<compileRecord>::iterator it = records.begin(); it != records.end(); it++) {
+
+        if (it != records.begin()) {
+            json += ",";
+        }
+
+        json += "\n{";
+        json += "\"date\": " + jsonString(it->fDate.toString(Qt::ISODate));
+        json += ", \"name\": " + jsonString(it->fName);
+        json += ", \"sha\": " + jsonString(it->fSHAKey);
+        json += ", \"tier\": " + jsonString(it->fTier);
+        json += ", \"success\": " + QString(it->fSuccess ? "true" : "false");
+        json += ", \"total\": " + toMs(it->fTotal);
+        json += ", \"phases\": {";
+
+        for (int i = 0; i < kPhaseNumber; i++) {
+            if (i != 0) {
+                json += ", ";
+            }
+            json += jsonString(phaseName(i)) + ": " + toMs(it->fPhases[i]);
+        }
+
+        json += "}}";
+    }
+
+    json += "\n]\n}";
+    return json;
+}
+
+QString FLCompileStats::toCSV()
+{
+    QVector<compileRecord> records = getRecords();
+
+    QString csv = "date,name,sha,tier,success,total_ms";
+    for (int i = 0; i < kPhaseNumber; i++) {
+        csv += QString(",") + phaseName(i) + "_ms";
+    }
+    csv += "\n";
+
+    for (QVector<compileRecord>::iterator it = records.begin(); it != records.end(); it++) {
+
+        csv += it->fDate.toString(Qt::ISODate) + "," + csvString(it->fName) + "," + it->fSHAKey + "," + it->fTier + ",";
+        csv += QString(it->fSuccess ? "1" : "0") + "," + toMs(it->fTotal);
+
+        for (int i = 0; i < kPhaseNumber; i++) {
+            csv += "," + toMs(it->fPhases[i]);
+        }
+        csv += "\n";
+    }
+
+    return csv;
+}
+
+bool FLCompileStats::writeCSV(const QString& path)
+{
+    QFile f(path);
+
+    if (!f.open(QFile::WriteOnly | QFile::Truncate)) {
+        return false;
+    }
+
+    QTextStream textWriting(&f);
+    textWriting << toCSV();
+    f.close();
+
+    return true;
+}
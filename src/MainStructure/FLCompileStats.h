@@ -0,0 +1,108 @@
+//
+//  FLCompileStats.h
+//
+//  This file is part of FaustLive, released under the GNU General Public License version 3 (see GPL.txt).
+//
+
+// FLCompileStats keeps the duration of each phase of the last factory creations in a ring buffer,
+// to tell whether a slow reload comes from the Faust front end, LLVM or the file system.
+// The records are printed in the message window, served by FLServerHttp (/stats/compile) and exported as CSV.
+// The summary and the JSON also report the hits and misses of the factory cache of FLSessionManager.
+
+#ifndef _FLCompileStats_h
+#define _FLCompileStats_h
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+#define kCompileStatsSize 256
+
+// Phases of FLSessionManager::createFactory
+enum CompilePhase {
+    kSourcePhase,           // ifUrlToString / ifFileToString
+    kExpandPhase,           // expandDSPFromString
+    kAuxFilesPhase,         // generateAuxFiles
+    kMachineCodeReadPhase,
+    kBitcodeReadPhase,
+    kCompilePhase,          // Faust front end + LLVM (or interpreter)
+    kBitcodeWritePhase,
+    kMachineCodeWritePhase,
+    kDependenciesPhase,     // getDependencies + writeDependencies
+    kPhaseNumber
+};
+
+struct compileRecord {
+
+    QDateTime   fDate;
+    QString     fName;
+    QString     fSHAKey;
+    QString     fTier;          // "interpreter", "cached", "machine code", "bitcode", "source" or "remote"
+    bool        fSuccess;
+    qint64      fPhases[kPhaseNumber];  // ns
+    qint64      fTotal;                 // ns
+
+    compileRecord() : fSuccess(false), fTotal(0)
+    {
+        for (int i = 0; i < kPhaseNumber; i++) {
+            fPhases[i] = 0;
+        }
+    }
+};
+
+// Measures one factory creation and adds it to the ring buffer when it goes out of scope
+class FLCompileRecorder
+{
+    private:
+
+        compileRecord   fRecord;
+        QElapsedTimer   fTotalTimer;
+        QElapsedTimer   fPhaseTimer;
+
+    public:
+
+        FLCompileRecorder();
+        virtual ~FLCompileRecorder();
+
+        void    startPhase();
+    //Adds the time elapsed since startPhase to the phase
+        void    endPhase(CompilePhase phase);
+
+        void    setName(const QString& name) { fRecord.fName = name; }
+        void    setSHAKey(const QString& shaKey) { fRecord.fSHAKey = shaKey; }
+        void    setTier(const QString& tier) { fRecord.fTier = tier; }
+        void    setSuccess(bool success) { fRecord.fSuccess = success; }
+};
+
+class FLCompileStats
+{
+    private:
+
+        QMutex                  fMutex;
+        QVector<compileRecord>  fRecords;
+        int                     fNext;      // Next slot of the ring buffer
+        int                     fCount;
+
+    //Records from the oldest to the newest
+        QVector<compileRecord>  getRecords();
+
+    public:
+
+        FLCompileStats();
+        virtual ~FLCompileStats();
+
+        static FLCompileStats*  _Instance();
+        static const char*      phaseName(int phase);
+
+        void        addRecord(const compileRecord& record);
+        void        clear();
+
+        QString     toSummary();
+        QString     toJSON();
+        QString     toCSV();
+        bool        writeCSV(const QString& path);
+};
+
+#endif
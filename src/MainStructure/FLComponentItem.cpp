@@ -108,7 +108,7 @@ void FLComponentItem::createInterfaceInRect(const QString& source)
     
     FLSessionManager* sessionManager = FLSessionManager::_Instance();
     
-    QPair<QString, void*> factorySetts = sessionManager->createFactory(source, NULL, errorMsg);
+    QPair<QString, void*> factorySetts = sessionManager->createFactory(source, sessionManager->getCompileSettings(NULL), errorMsg);
     
     if(factorySetts.second == NULL){
         FLErrorWindow::_Instance()->print_Error(errorMsg);
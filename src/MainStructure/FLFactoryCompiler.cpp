@@ -0,0 +1,154 @@
+//
+//  FLFactoryCompiler.cpp
+//
+//  This file is part of FaustLive, released under the GNU General Public License version 3 (see GPL.txt).
+//
+
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThread>
+
+#include "FLFactoryCompiler.h"
+#include "FLSessionManager.h"
+#include "FLSettings.h"
+#include "FLWinSettings.h"
+
+FLFactoryCompiler* FLFactoryCompiler::_compilerInstance = NULL;
+
+//--------------------------COMPILATION JOB--------------------------------
+
+// The job runs in a thread of the pool and sends its result back to the compiler living in the GUI thread
+class FLFactoryJob : public QRunnable
+{
+    private:
+
+        FLFactoryCompiler*  fCompiler;
+        int                 fTicket;
+        QString             fSource;
+        compileSettings     fSettings;
+        bool                fInterpreterFirst;
+
+    public:
+
+        FLFactoryJob(FLFactoryCompiler* compiler, int ticket, const QString& source, const compileSettings& settings, bool interpreterFirst)
+        :fCompiler(compiler), fTicket(ticket), fSource(source), fSettings(settings), fInterpreterFirst(interpreterFirst)
+        {}
+
+        virtual void run()
+        {
+            QString errorMsg("");
+            QPair<QString, void*> factorySetts = FLSessionManager::_Instance()->createFactory(fSource, fSettings, errorMsg, fInterpreterFirst);
+
+            QMetaObject::invokeMethod(fCompiler, "jobFinished", Qt::QueuedConnection,
+                                      Q_ARG(int, fTicket),
+                                      Q_ARG(QString, factorySetts.first),
+                                      Q_ARG(void*, factorySetts.second),
+                                      Q_ARG(QString, errorMsg));
+        }
+};
+
+// A job of compileAll : the result is written in place and the waiting thread is released
+class FLFactoryBatchJob : public QRunnable
+{
+    private:
+
+        QString                 fSource;
+        compileSettings         fSettings;
+        QPair<QString, void*>*  fResult;
+        QString*                fError;
+        QSemaphore*             fDone;
+
+    public:
+
+        FLFactoryBatchJob(const QString& source, const compileSettings& settings, QPair<QString, void*>* result, QString* error, QSemaphore* done)
+        :fSource(source), fSettings(settings), fResult(result), fError(error), fDone(done)
+        {}
+
+        virtual void run()
+        {
+            *fResult = FLSessionManager::_Instance()->createFactory(fSource, fSettings, *fError);
+            fDone->release();
+        }
+};
+
+//----------------------CONSTRUCTOR/DESTRUCTOR---------------------------
+
+FLFactoryCompiler::FLFactoryCompiler()
+{
+    fLastTicket = 0;
+    
+    int threads = FLSettings::_Instance()->value("General/Compilation/Threads", QThread::idealThreadCount()).toInt();
+    fPool.setMaxThreadCount(threads > 0 ? threads : 1);
+}
+
+FLFactoryCompiler::~FLFactoryCompiler()
+{
+    fPool.waitForDone();
+}
+
+FLFactoryCompiler* FLFactoryCompiler::_Instance()
+{
+    if (_compilerInstance == NULL) {
+        FLFactoryCompiler::_compilerInstance = new FLFactoryCompiler;
+    }
+
+    return FLFactoryCompiler::_compilerInstance;
+}
+
+void FLFactoryCompiler::deleteInstance()
+{
+    delete FLFactoryCompiler::_compilerInstance;
+    FLFactoryCompiler::_compilerInstance = NULL;
+}
+
+//-------------------------- COMPILATION ----------------------------------
+
+int FLFactoryCompiler::compile(const QString& source, FLWinSettings* settings, bool interpreterFirst)
+{
+    int ticket = ++fLastTicket;
+    fPool.start(new FLFactoryJob(this, ticket, source, FLSessionManager::_Instance()->getCompileSettings(settings), interpreterFirst));
+    return ticket;
+}
+
+QList<QPair<QString, void*> > FLFactoryCompiler::compileAll(const QList<QString>& sources, const QList<FLWinSettings*>& settings, QList<QString>& errors)
+{
+    QList<QPair<QString, void*> > factories;
+    
+    errors.clear();
+    
+    for (int i = 0; i < sources.size(); i++) {
+        factories.push_back(qMakePair(QString(""), (void*)NULL));
+        errors.push_back("");
+    }
+    
+    // The lists are not modified anymore : the jobs can safely write in their own element
+    QSemaphore done;
+    int launched = 0;
+    
+    for (int i = 0; i < sources.size(); i++) {
+        if (sources[i] != "") {
+            fPool.start(new FLFactoryBatchJob(sources[i], FLSessionManager::_Instance()->getCompileSettings(settings[i]), &factories[i], &errors[i], &done));
+            launched++;
+        }
+    }
+    
+    done.acquire(launched);
+    return factories;
+}
+
+void FLFactoryCompiler::cancel(int ticket)
+{
+    if (ticket > 0) {
+        fCancelledTickets.insert(ticket);
+    }
+}
+
+//Called in the GUI thread once the worker thread is done
+void FLFactoryCompiler::jobFinished(int ticket, const QString& shaKey, void* factorySetts, const QString& errorMsg)
+{
+    if (fCancelledTickets.remove(ticket)) {
+        FLSessionManager::_Instance()->deleteFactory(qMakePair(shaKey, factorySetts));
+    } else {
+        emit factoryCompiled(ticket, shaKey, factorySetts, errorMsg);
+    }
+}
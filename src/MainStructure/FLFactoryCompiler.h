@@ -0,0 +1,66 @@
+//
+//  FLFactoryCompiler.h
+//
+//  This file is part of FaustLive, released under the GNU General Public License version 3 (see GPL.txt).
+//
+
+// FLFactoryCompiler moves the factory creation (FLSessionManager::createFactory) out of the GUI thread.
+// A window asks for a compilation and receives a ticket. When the worker thread is done, factoryCompiled is emitted
+// in the GUI thread with the same ticket, so that the window can swap its DSP. Meanwhile, the previous DSP keeps playing.
+// The settings of the window are copied when the compilation is asked : the worker threads never read them.
+// The number of compilation threads is bounded by General/Compilation/Threads (default : number of cores).
+// It is a singleton in order to be easily acccessible from any another class.
+
+#ifndef _FLFactoryCompiler_h
+#define _FLFactoryCompiler_h
+
+#include <QObject>
+#include <QList>
+#include <QSet>
+#include <QPair>
+#include <QString>
+#include <QThreadPool>
+
+class FLWinSettings;
+
+class FLFactoryCompiler : public QObject
+{
+    private:
+
+        Q_OBJECT
+
+        QThreadPool     fPool;
+        int             fLastTicket;
+        QSet<int>       fCancelledTickets;   // Results of these tickets are deleted as soon as they arrive
+
+        static FLFactoryCompiler* _compilerInstance;
+
+    private slots:
+
+        void            jobFinished(int ticket, const QString& shaKey, void* factorySetts, const QString& errorMsg);
+
+    public:
+
+        FLFactoryCompiler();
+        virtual ~FLFactoryCompiler();
+
+        static FLFactoryCompiler* _Instance();
+        static void deleteInstance();
+
+    //Queues the compilation of source and returns the ticket that will identify the result
+        int             compile(const QString& source, FLWinSettings* settings, bool interpreterFirst = false);
+
+    //Compiles the sources concurrently and waits for all of them (used to restore a session)
+    //An empty source is not compiled : its factory is NULL and its error is empty
+        QList<QPair<QString, void*> > compileAll(const QList<QString>& sources, const QList<FLWinSettings*>& settings, QList<QString>& errors);
+    
+    //The result of ticket is not wanted anymore (the window was closed or a newer compilation was asked)
+        void            cancel(int ticket);
+
+    signals:
+
+    //factorySetts is NULL if the compilation failed, errorMsg is then filled
+        void            factoryCompiled(int ticket, const QString& shaKey, void* factorySetts, const QString& errorMsg);
+};
+
+#endif
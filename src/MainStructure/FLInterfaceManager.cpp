@@ -7,13 +7,48 @@
 
 #include "FLInterfaceManager.h"
 
+//----------------------ZONE TRACKER---------------------------
+
+void FLZoneTracker::addZone(FAUSTFLOAT* zone)
+{
+    fZones.push_back(zone);
+    fValues.push_back(*zone);
+}
+
+bool FLZoneTracker::hasChanged()
+{
+    bool changed = false;
+    
+    for (size_t i = 0; i < fZones.size(); i++) {
+        FAUSTFLOAT value = *fZones[i];
+        
+        if (value != fValues[i]) {
+            fValues[i] = value;
+            changed = true;
+        }
+    }
+    
+    return changed;
+}
+
 FLInterfaceManager* FLInterfaceManager::_interfaceManagerInstance = NULL;
 
 //----------------------CONSTRUCTOR/DESTRUCTOR---------------------------
 
-FLInterfaceManager::FLInterfaceManager(){}
+FLInterfaceManager::FLInterfaceManager()
+{
+    fTick = 0;
+    fHiddenDivider = kHiddenGuiRefreshRate / kGuiRefreshRate;
+}
 
-FLInterfaceManager::~FLInterfaceManager(){}
+FLInterfaceManager::~FLInterfaceManager()
+{
+    std::map<const void*, FLGuiGroup>::iterator it;
+    
+    for (it = fGroups.begin(); it != fGroups.end(); it++) {
+        delete it->second.fTracker;
+    }
+}
 
 FLInterfaceManager* FLInterfaceManager::_Instance()
 {
@@ -24,26 +59,121 @@ FLInterfaceManager* FLInterfaceManager::_Instance()
     return FLInterfaceManager::_interfaceManagerInstance;
 }
 
+//Only the interfaces of the windows whose zones changed are updated. In those, updateAllZones only reflects the items which cached value differs
 void FLInterfaceManager::updateAllGuis()
 {
     if (fLocker.Lock()) {
-        GUI::updateAllGuis();
+        
+        fTick++;
+        
+        std::map<const void*, FLGuiGroup>::iterator it;
+        
+        for (it = fGroups.begin(); it != fGroups.end(); it++) {
+            
+            FLGuiGroup& group = it->second;
+            
+            if (!group.fVisible && (fTick % fHiddenDivider) != 0) {
+                continue;
+            }
+            
+            //Without registered zones, the window can't be tracked and is always updated
+            bool changed = (group.fTracker) ? group.fTracker->hasChanged() : true;
+            
+            if (changed || group.fForceUpdate) {
+                std::list<GUI*>::iterator gui;
+                
+                for (gui = group.fGuis.begin(); gui != group.fGuis.end(); gui++) {
+                    (*gui)->updateAllZones();
+                }
+                
+                group.fForceUpdate = false;
+            }
+        }
+        
+        fLocker.Unlock();
+    }
+}
+
+void FLInterfaceManager::setRefreshRates(int refreshRate, int hiddenRefreshRate)
+{
+    if (fLocker.Lock()) {
+        fHiddenDivider = (refreshRate > 0 && hiddenRefreshRate > refreshRate) ? hiddenRefreshRate / refreshRate : 1;
+        fLocker.Unlock();
+    }
+}
+
+void FLInterfaceManager::registerGUI(GUI* ui, const void* owner)
+{
+    if (fLocker.Lock()) {
+        FLGuiGroup& group = fGroups[owner];
+        group.fGuis.push_back(ui);
+        group.fForceUpdate = true;
+        fLocker.Unlock();
+    }
+}
+
+void FLInterfaceManager::unregisterGUI(GUI* ui, const void* owner)
+{
+    if (fLocker.Lock()) {
+        std::map<const void*, FLGuiGroup>::iterator it = fGroups.find(owner);
+        
+        if (it != fGroups.end()) {
+            it->second.fGuis.remove(ui);
+        }
+        fLocker.Unlock();
+    }
+}
+
+void FLInterfaceManager::registerZones(dsp* DSP, const void* owner)
+{
+    FLZoneTracker* tracker = new FLZoneTracker;
+    DSP->buildUserInterface(tracker);
+    
+    if (fLocker.Lock()) {
+        FLGuiGroup& group = fGroups[owner];
+        delete group.fTracker;
+        group.fTracker = tracker;
+        group.fForceUpdate = true;
+        fLocker.Unlock();
+    }
+}
+
+void FLInterfaceManager::unregisterZones(const void* owner)
+{
+    if (fLocker.Lock()) {
+        std::map<const void*, FLGuiGroup>::iterator it = fGroups.find(owner);
+        
+        if (it != fGroups.end()) {
+            delete it->second.fTracker;
+            it->second.fTracker = NULL;
+        }
         fLocker.Unlock();
     }
 }
 
-void FLInterfaceManager::registerGUI(GUI* ui)
+void FLInterfaceManager::unregisterOwner(const void* owner)
 {
     if (fLocker.Lock()) {
-        fGuiList.push_back(ui);
+        std::map<const void*, FLGuiGroup>::iterator it = fGroups.find(owner);
+        
+        if (it != fGroups.end()) {
+            delete it->second.fTracker;
+            fGroups.erase(it);
+        }
         fLocker.Unlock();
     }
 }
 
-void FLInterfaceManager::unregisterGUI(GUI* ui)
+//A window coming back to the front is synchronized at the next refresh
+void FLInterfaceManager::setVisible(const void* owner, bool visible)
 {
     if (fLocker.Lock()) {
-        fGuiList.remove(ui);
+        FLGuiGroup& group = fGroups[owner];
+        
+        if (visible && !group.fVisible) {
+            group.fForceUpdate = true;
+        }
+        group.fVisible = visible;
         fLocker.Unlock();
     }
 }
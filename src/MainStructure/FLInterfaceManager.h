@@ -11,10 +11,15 @@
 // FLInterfaceManager keeps track of the interfaces registered and can update them, protecting multiple access to the interface list with a Mutex.
 // It is a singleton in order to be easily acccessible from any another class.
 
+// The interfaces are grouped by window. At each refresh, the zones of a window are compared to a snapshot taken at the previous refresh :
+// the interfaces of a window are only updated if one of its zones changed. Hidden or minimized windows are refreshed at a lower rate.
+
 #ifndef _FLInterfaceManager_h
 #define _FLInterfaceManager_h
 
 #include <list>
+#include <map>
+#include <vector>
 #include "TMutex.h"
 
 #if defined(_WIN32) && !defined(GCC)
@@ -23,13 +28,55 @@
 # pragma GCC diagnostic ignored "-Wunused-parameter"
 #endif
 #include "faust/gui/GUI.h"
+#include "faust/gui/DecoratorUI.h"
+#include "faust/dsp/dsp.h"
+
+#define kGuiRefreshRate 100         // ms
+#define kHiddenGuiRefreshRate 1000  // ms
+
+// Flat copy of the zones of a DSP. The DSP, OSC and MIDI threads write the zones directly, so the changes are found by comparing with the snapshot
+class FLZoneTracker : public GenericUI
+{
+    private:
+    
+        std::vector<FAUSTFLOAT*>    fZones;
+        std::vector<FAUSTFLOAT>     fValues;
+    
+        void addZone(FAUSTFLOAT* zone);
+    
+    public:
+    
+        virtual void addButton(const char* label, FAUSTFLOAT* zone) { addZone(zone); }
+        virtual void addCheckButton(const char* label, FAUSTFLOAT* zone) { addZone(zone); }
+        virtual void addVerticalSlider(const char* label, FAUSTFLOAT* zone, FAUSTFLOAT init, FAUSTFLOAT min, FAUSTFLOAT max, FAUSTFLOAT step) { addZone(zone); }
+        virtual void addHorizontalSlider(const char* label, FAUSTFLOAT* zone, FAUSTFLOAT init, FAUSTFLOAT min, FAUSTFLOAT max, FAUSTFLOAT step) { addZone(zone); }
+        virtual void addNumEntry(const char* label, FAUSTFLOAT* zone, FAUSTFLOAT init, FAUSTFLOAT min, FAUSTFLOAT max, FAUSTFLOAT step) { addZone(zone); }
+        virtual void addHorizontalBargraph(const char* label, FAUSTFLOAT* zone, FAUSTFLOAT min, FAUSTFLOAT max) { addZone(zone); }
+        virtual void addVerticalBargraph(const char* label, FAUSTFLOAT* zone, FAUSTFLOAT min, FAUSTFLOAT max) { addZone(zone); }
+    
+        //Returns true if a zone changed since the last call and takes a new snapshot
+        bool hasChanged();
+};
 
 class FLInterfaceManager
 {
     private:
     
+        // Interfaces and zones of one window
+        struct FLGuiGroup {
+            std::list<GUI*> fGuis;
+            FLZoneTracker*  fTracker;
+            bool            fVisible;
+            bool            fForceUpdate;   // A new interface has to be synchronized at the next refresh
+            
+            FLGuiGroup() : fTracker(NULL), fVisible(true), fForceUpdate(true) {}
+        };
+    
         TMutex fLocker;
-        std::list<GUI*>	fGuiList;
+        std::map<const void*, FLGuiGroup>	fGroups;
+    
+        int fTick;
+        int fHiddenDivider;     // A hidden window is refreshed every fHiddenDivider ticks
         
         static FLInterfaceManager* _interfaceManagerInstance;
         
@@ -39,10 +86,23 @@ class FLInterfaceManager
         virtual ~FLInterfaceManager();
 
         static FLInterfaceManager* _Instance();
-  
+    
+        //Called by the refresh timer, every refreshRate ms
         void updateAllGuis();
-        void registerGUI(GUI* ui);
-        void unregisterGUI(GUI* ui);
+        void setRefreshRates(int refreshRate, int hiddenRefreshRate);
+    
+        //owner is the window the interface belongs to
+        void registerGUI(GUI* ui, const void* owner);
+        void unregisterGUI(GUI* ui, const void* owner);
+    
+        //The zones of the DSP of a window, to be unregistered before the DSP is deleted
+        void registerZones(dsp* DSP, const void* owner);
+        void unregisterZones(const void* owner);
+    
+        void setVisible(const void* owner, bool visible);
+    
+        //Forgets a window and its refresh state
+        void unregisterOwner(const void* owner);
 };
 
 #endif
@@ -0,0 +1,199 @@
+//
+//  FLSHAFolderCache.cpp
+//
+//  This file is part of FaustLive, released under the GNU General Public License version 3 (see GPL.txt).
+//
+
+#include <QDir>
+#include <QFileInfo>
+#include <QSettings>
+
+#include <algorithm>
+
+#include "FLSHAFolderCache.h"
+
+//----------------------CONSTRUCTOR/DESTRUCTOR---------------------------
+
+FLSHAFolderCache::FLSHAFolderCache(const QString& sessionFolder)
+{
+    fSHAFolder = sessionFolder + "/SHAFolder";
+    fIndexFile = sessionFolder + "/SHAIndex.ini";
+    fTotalSize = 0;
+    
+    load();
+}
+
+FLSHAFolderCache::~FLSHAFolderCache()
+{
+    save();
+}
+
+qint64 FLSHAFolderCache::folderSize(const QString& path)
+{
+    qint64 size = 0;
+    QFileInfoList children = QDir(path).entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden);
+    
+    for (QFileInfoList::iterator it = children.begin(); it != children.end(); it++) {
+        size += (it->isDir()) ? folderSize(it->absoluteFilePath()) : it->size();
+    }
+    
+    return size;
+}
+
+//The index is reconciled with the folder : entries which folder disapeared are dropped, unknown folders are measured
+void FLSHAFolderCache::load()
+{
+    QSettings index(fIndexFile, QSettings::IniFormat);
+    QStringList indexed = index.childGroups();
+    QFileInfoList children = QDir(fSHAFolder).entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot);
+    
+    for (QFileInfoList::iterator it = children.begin(); it != children.end(); it++) {
+        
+        QString shaKey = it->fileName();
+        shaFolderEntry entry;
+        
+        if (indexed.contains(shaKey)) {
+            index.beginGroup(shaKey);
+            entry.fSize = index.value("Size", 0).toLongLong();
+            entry.fLastUse = index.value("LastUse", it->lastModified()).toDateTime();
+            entry.fHits = index.value("Hits", 0).toInt();
+            
+            QStringList snapshots = index.value("Snapshots", QStringList()).toStringList();
+            for (int i = 0; i < snapshots.size(); i++) {
+                if (QFileInfo(snapshots[i]).exists() || QFileInfo(snapshots[i] + ".tar").exists()) {
+                    entry.fSnapshots.push_back(snapshots[i]);
+                }
+            }
+            index.endGroup();
+        } else {
+            entry.fSize = folderSize(it->absoluteFilePath());
+            entry.fLastUse = it->lastModified();
+        }
+        
+        fEntries[shaKey] = entry;
+        fTotalSize += entry.fSize;
+    }
+}
+
+void FLSHAFolderCache::save()
+{
+    QMutexLocker locker(&fMutex);
+    
+    QSettings index(fIndexFile, QSettings::IniFormat);
+    index.clear();
+    
+    for (QMap<QString, shaFolderEntry>::iterator it = fEntries.begin(); it != fEntries.end(); it++) {
+        index.beginGroup(it.key());
+        index.setValue("Size", it->fSize);
+        index.setValue("LastUse", it->fLastUse);
+        index.setValue("Hits", it->fHits);
+        if (!it->fSnapshots.isEmpty()) {
+            index.setValue("Snapshots", it->fSnapshots);
+        }
+        index.endGroup();
+    }
+}
+
+//-------------------------- ACCESSES ----------------------------------
+
+void FLSHAFolderCache::touch(const QString& shaKey)
+{
+    QMutexLocker locker(&fMutex);
+    
+    shaFolderEntry& entry = fEntries[shaKey];
+    entry.fLastUse = QDateTime::currentDateTime();
+    entry.fHits++;
+}
+
+void FLSHAFolderCache::updateSize(const QString& shaKey)
+{
+    qint64 size = folderSize(fSHAFolder + "/" + shaKey);
+    
+    QMutexLocker locker(&fMutex);
+    
+    shaFolderEntry& entry = fEntries[shaKey];
+    fTotalSize += size - entry.fSize;
+    entry.fSize = size;
+    
+    if (!entry.fLastUse.isValid()) {
+        entry.fLastUse = QDateTime::currentDateTime();
+    }
+}
+
+void FLSHAFolderCache::remove(const QString& shaKey)
+{
+    QMutexLocker locker(&fMutex);
+    
+    QMap<QString, shaFolderEntry>::iterator it = fEntries.find(shaKey);
+    
+    if (it != fEntries.end()) {
+        fTotalSize -= it->fSize;
+        fEntries.erase(it);
+    }
+}
+
+void FLSHAFolderCache::pin(const QString& shaKey, const QString& snapshotFolder)
+{
+    fMutex.lock();
+    
+    shaFolderEntry& entry = fEntries[shaKey];
+    if (!entry.fSnapshots.contains(snapshotFolder)) {
+        entry.fSnapshots.push_back(snapshotFolder);
+    }
+    
+    fMutex.unlock();
+    
+    save();
+}
+
+bool FLSHAFolderCache::isPinned(const shaFolderEntry& entry)
+{
+    return !entry.fSnapshots.isEmpty();
+}
+
+qint64 FLSHAFolderCache::totalSize()
+{
+    QMutexLocker locker(&fMutex);
+    return fTotalSize;
+}
+
+//-------------------------- EVICTION ----------------------------------
+
+static bool olderUse(const QPair<QDateTime, QString>& a, const QPair<QDateTime, QString>& b)
+{
+    return a.first < b.first;
+}
+
+//Evicting in batch down to 90% leaves room for the next compilations instead of deleting one folder at each of them
+QStringList FLSHAFolderCache::evictionCandidates(qint64 budget, int maxFolders)
+{
+    QMutexLocker locker(&fMutex);
+    
+    QStringList candidates;
+    
+    if (fTotalSize <= budget && fEntries.size() <= maxFolders) {
+        return candidates;
+    }
+    
+    QList<QPair<QDateTime, QString> > byLastUse;
+    
+    for (QMap<QString, shaFolderEntry>::iterator it = fEntries.begin(); it != fEntries.end(); it++) {
+        if (!isPinned(*it)) {
+            byLastUse.push_back(qMakePair(it->fLastUse, it.key()));
+        }
+    }
+    
+    std::sort(byLastUse.begin(), byLastUse.end(), olderUse);
+    
+    for (int i = 0; i < byLastUse.size(); i++) {
+        candidates.push_back(byLastUse[i].second);
+    }
+    
+    return candidates;
+}
+
+bool FLSHAFolderCache::isAboveTarget(qint64 budget, int maxFolders)
+{
+    QMutexLocker locker(&fMutex);
+    return fTotalSize > budget * 9 / 10 || fEntries.size() > maxFolders * 9 / 10;
+}
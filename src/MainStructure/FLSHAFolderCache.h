@@ -0,0 +1,72 @@
+//
+//  FLSHAFolderCache.h
+//
+//  This file is part of FaustLive, released under the GNU General Public License version 3 (see GPL.txt).
+//
+
+// FLSHAFolderCache is the index of the SHAFolder of the session : size, last use and number of uses of each SHA key folder.
+// It is loaded once when the session manager is created and saved in SHAIndex.ini, so that keeping the folder within its
+// byte budget does not need to scan it at each compilation.
+// The SHA keys saved in a snapshot are pinned as long as the snapshot exists.
+
+#ifndef _FLSHAFolderCache_h
+#define _FLSHAFolderCache_h
+
+#include <QDateTime>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+#define kSHAFolderBudget 1024   // MB
+#define kMaxSHAFolders 100
+
+class FLSHAFolderCache
+{
+    private:
+    
+        struct shaFolderEntry {
+            qint64      fSize;
+            QDateTime   fLastUse;
+            int         fHits;
+            QStringList fSnapshots;     // Snapshots referencing the SHA key
+            
+            shaFolderEntry() : fSize(0), fHits(0) {}
+        };
+    
+        QString                         fSHAFolder;
+        QString                         fIndexFile;
+    
+        QMutex                          fMutex;
+        QMap<QString, shaFolderEntry>   fEntries;
+        qint64                          fTotalSize;
+    
+        static qint64   folderSize(const QString& path);
+    
+        void            load();
+        bool            isPinned(const shaFolderEntry& entry);
+    
+    public:
+    
+        FLSHAFolderCache(const QString& sessionFolder);
+        virtual ~FLSHAFolderCache();
+    
+        void            save();
+    
+    //The SHA key folder was used by a compilation
+        void            touch(const QString& shaKey);
+    //Files were added in the SHA key folder
+        void            updateSize(const QString& shaKey);
+        void            remove(const QString& shaKey);
+    
+        void            pin(const QString& shaKey, const QString& snapshotFolder);
+    
+    //Least recently used SHA keys that are not pinned, oldest first, once the budget (in bytes and in number of folders) is exceeded.
+    //They are evicted until the folder is back under 90% of the budget (see isAboveTarget)
+        QStringList     evictionCandidates(qint64 budget, int maxFolders);
+        bool            isAboveTarget(qint64 budget, int maxFolders);
+    
+        qint64          totalSize();
+};
+
+#endif
@@ -19,12 +19,15 @@
 #include "FLWinSettings.h"
 #include "utilities.h"
 #include "FLErrorWindow.h"
+#include "FLSHAFolderCache.h"
+#include "FLCompileStats.h"
 #include "QTDefs.h"
 
 #include "faust/dsp/timed-dsp.h"
 #include "faust/dsp/libfaust.h"
 #include "faust/gui/SoundUI.h"
 #include "faust/dsp/dsp-adapter.h"
+#include "faust/gui/DecoratorUI.h"
 
 #include <assert.h>
 
@@ -32,7 +35,6 @@
 #include "faust/dsp/poly-llvm-dsp.h"
 
 #define DEFAULTNAME "DefaultName"
-#define kMaxSHAFolders 100
 
 /* When creating a new DSP, it is associated to a unique SHA Key calculated from 
  the faust code, the name and the compilation options */
@@ -40,14 +42,39 @@
 
 FLSessionManager* FLSessionManager::_sessionManager = 0;
 
+//Holds the lock of a SHA key folder until the end of the compilation
+class FLSHAKeyLocker
+{
+    private:
+    
+        FLSessionManager*   fManager;
+        QString             fSHAKey;
+    
+    public:
+    
+        FLSHAKeyLocker(FLSessionManager* manager, const QString& shaKey) : fManager(manager), fSHAKey(shaKey)
+        {
+            fManager->lockSHAKey(fSHAKey);
+        }
+    
+        ~FLSHAKeyLocker()
+        {
+            fManager->unlockSHAKey(fSHAKey);
+        }
+};
+
 //----------------------CONSTRUCTOR/DESTRUCTOR---------------------------
 FLSessionManager::FLSessionManager(const QString& sessionFolder)
 {
     fSessionFolder = sessionFolder;
+    fSHACache = new FLSHAFolderCache(sessionFolder);
 }
 
 FLSessionManager::~FLSessionManager()
-{}
+{
+    delete fSHACache;
+    qDeleteAll(fSHALocks);
+}
 
 FLSessionManager* FLSessionManager::_Instance()
 {
@@ -69,12 +96,47 @@ void FLSessionManager::deleteInstance()
 /* The compilation is divided into 2 steps : factory creation then instance creation */
 /* It is not possible to merge those 2 functions because some audio init is needed in between */
 
-QPair<QString, void*> FLSessionManager::createFactory(const QString& source, FLWinSettings* settings, QString& errorMsg)
+/* createFactory may be called from a compilation thread : it does not touch the GUI nor the QSettings, errors that are not fatal are emitted */
+
+compileSettings FLSessionManager::getCompileSettings(FLWinSettings* settings)
+{
+    FLSettings* generalSettings = FLSettings::_Instance();
+    compileSettings compileSetts;
+    
+    compileSetts.fFaustOptions = generalSettings->value("General/Compilation/FaustOptions", "").toString();
+    compileSetts.fOptLevel = generalSettings->value("General/Compilation/OptValue", -1).toInt();
+    compileSetts.fMachineName = "local processing";
+    compileSetts.fMachineCodeCache = generalSettings->value("General/Compilation/MachineCodeCache", false).toBool();
+    compileSetts.fSHAFolderBudget = generalSettings->value("General/Compilation/SHAFolderBudget", kSHAFolderBudget).toLongLong() * 1024 * 1024;
+    
+    if (settings) {
+        compileSetts.fWindow = true;
+        compileSetts.fFaustOptions = settings->value("Compilation/FaustOptions", compileSetts.fFaustOptions).toString();
+        compileSetts.fOptLevel = settings->value("Compilation/OptValue", compileSetts.fOptLevel).toInt();
+        compileSetts.fMachineName = settings->value("RemoteProcessing/MachineName", compileSetts.fMachineName).toString();
+        compileSetts.fMachineIP = settings->value("RemoteProcessing/MachineIP", "127.0.0.1").toString();
+        compileSetts.fMachinePort = settings->value("RemoteProcessing/MachinePort", 7777).toInt();
+        compileSetts.fPolyphony = settings->value("Polyphony/Enabled", generalSettings->value("General/Control/PolyphonyDefaultChecked", false)).toBool();
+        compileSetts.fVoices = settings->value("Polyphony/Voice", "4").toString();
+        compileSetts.fGroup = settings->value("Polyphony/GroupEnabled", generalSettings->value("General/Control/PolyphonyGroupDefaultChecked", false)).toBool();
+        compileSetts.fPath = settings->value("Path", "").toString();
+        compileSetts.fExportOptions = settings->value("AutomaticExport/Options", "").toString();
+        compileSetts.fScriptOptions = settings->value("Script/Options", "").toString();
+    }
+    
+    return compileSetts;
+}
+
+QPair<QString, void*> FLSessionManager::createFactory(const QString& source, const compileSettings& settings, QString& errorMsg, bool interpreterFirst)
 {
     //-------Clean factory folder if needed
-    cleanSHAFolder();
+    cleanSHAFolder(settings.fSHAFolderBudget);
+    
+    //-------Time of each phase, recorded when leaving the function
+    FLCompileRecorder recorder;
     
     //-------Get Faust code
+    recorder.startPhase();
     QString faustContent = ifUrlToString(source);
     
     //Path is whether the dsp source unmodified or the waveform converted
@@ -84,41 +146,40 @@ QPair<QString, void*> FLSessionManager::createFactory(const QString& source, FLW
     }
     
     faustContent = ifFileToString(faustContent);
+    recorder.endPhase(kSourcePhase);
     
     //------Get name
     QString name = ifFileToName(path);
     if (name == "") {
         name = getDeclareName(faustContent, "DefaultName");
     }
+    recorder.setName(name);
     
     //--------Calculation of SHA key
     
-    //-----Extracting compilation Options from general options Or window options
-    QString defaultOptions = FLSettings::_Instance()->value("General/Compilation/FaustOptions", "").toString();
-    int defaultOptLevel = FLSettings::_Instance()->value("General/Compilation/OptValue", -1).toInt();
-    
-    QString faustOptions = defaultOptions;
-    int optLevel = defaultOptLevel;
-    
-    if (settings) {
-        faustOptions = settings->value("Compilation/FaustOptions", defaultOptions).toString();
-        optLevel = settings->value("Compilation/OptValue", defaultOptLevel).toInt();
-    }
-    
-    QString machineName = "local processing";
-    if (settings) {
-        machineName = settings->value("RemoteProcessing/MachineName", machineName).toString();
-    }
+    //-----Compilation Options from general options Or window options
+    QString faustOptions = settings.fFaustOptions;
+    int optLevel = settings.fOptLevel;
+    QString machineName = settings.fMachineName;
     
     int argc;
-    const char** argv = getFactoryArgv(path, faustOptions, ((machineName == "local processing") ? NULL : settings), argc);
+    const char** argv = getFactoryArgv(path, faustOptions, ((machineName == "local processing") ? NULL : &settings), argc);
     string shaKey, err;
-    //EXPAND DSP JUST TO GET SHA KEY
+    
+    //EXPAND DSP JUST TO GET SHA KEY, unless the same code was already expanded with the same options and libraries
+    recorder.startPhase();
+    QString expansionKey = getExpansionKey(name, faustContent, argc, argv);
+    shaKey = readExpansionSHAKey(expansionKey).toStdString();
 
-    if (expandDSPFromString(name.toStdString(), faustContent.toStdString(), argc, argv, shaKey, err) == "") {
-        errorMsg = err.c_str();
-        return qMakePair(QString(""), (void*)NULL);
+    if (shaKey == "") {
+        if (expandDSPFromString(name.toStdString(), faustContent.toStdString(), argc, argv, shaKey, err) == "") {
+            errorMsg = err.c_str();
+            return qMakePair(QString(""), (void*)NULL);
+        }
+        writeExpansionSHAKey(expansionKey, shaKey.c_str());
     }
+    recorder.endPhase(kExpandPhase);
+    recorder.setSHAKey(shaKey.c_str());
 
 //  shaKey = "8F41F6181694A1B561F33328CF75A82DB5E22934";
 //	string organizedOptions = FL_reorganize_compilation_options(faustOptions);
@@ -128,6 +189,9 @@ QPair<QString, void*> FLSessionManager::createFactory(const QString& source, FLW
 //  string fullShaString = organizedOptions + optvalue + faustContent.toStdString();
 //  string shaKey = FL_generate_sha1(fullShaString);
     
+    FLSHAKeyLocker shaLocker(this, shaKey.c_str());
+    fSHACache->touch(shaKey.c_str());
+    
     QString factoryFolder = fSessionFolder + "/SHAFolder/" + shaKey.c_str();
     string irFile = factoryFolder.toStdString() + "/" + shaKey;
     QString faustFile = factoryFolder + "/" + shaKey.c_str() + ".dsp";
@@ -146,73 +210,169 @@ QPair<QString, void*> FLSessionManager::createFactory(const QString& source, FLW
     factory* toCompile = new factory();
     string error = "";
     
-//------ Additionnal compilation step or options (if set so in settings)
-    if (settings) {
+//------ Interpreter tier : the factory is created in a few milliseconds and will be replaced by the LLVM one, compiled in the background
+//------ Polyphonic DSP, and DSP which LLVM factory is already cached or saved as native code, do not need it
+    QString cacheKey = QString(shaKey.c_str()) + "-O" + QString::number(optLevel);
+    bool interpreterTier = false;
+    
+#ifdef LLVM_DSP_FACTORY
+    if (interpreterFirst && settings.fWindow && machineName == "local processing"
+        && !settings.fPolyphony
+        && !hasCachedFactory(cacheKey)
+        && !(settings.fMachineCodeCache && QFileInfo(getMachineCodeFile(factoryFolder, shaKey.c_str(), optLevel)).exists())) {
+        interpreterTier = true;
+    }
+#endif
+    
+//------ Additionnal compilation step or options (if set so in settings), done once by the LLVM tier
+    if (settings.fWindow && !interpreterTier) {
        QString errMsg;
-        if (!generateAuxFiles(shaKey.c_str(), settings->value("Path", "").toString(),
-            settings->value("AutomaticExport/Options", "").toString(), shaKey.c_str(), errMsg)) {
-			FLErrorWindow::_Instance()->print_Error(QString("Additional Compilation Step : ") + errMsg);
+        recorder.startPhase();
+        if (!generateAuxFiles(shaKey.c_str(), settings.fPath, settings.fExportOptions, shaKey.c_str(), errMsg)) {
+            emit this->error(QString("Additional Compilation Step : ") + errMsg);
         }
+        recorder.endPhase(kAuxFilesPhase);
     }
     
 //------ Compile local factory
     if (machineName == "local processing") {
         mySetts->fType = TYPE_LOCAL;
         
-        //----Use IR Saving if possible
-        if (QFileInfo(irFile.c_str()).exists()) {
-        #ifdef LLVM_DSP_FACTORY
-            toCompile->fLLVMFactory = readPolyDSPFactoryFromBitcodeFile(irFile, "", error, optLevel);
-        #else
-            toCompile->fLLVMFactory = NULL;  // TODO
-        #endif
+        //----Share the factory of another window if possible
+        factoryCacheEntry* cached = (interpreterTier) ? NULL : acquireCachedFactory(cacheKey);
+        
+        if (interpreterTier) {
+            recorder.setTier("interpreter");
+            recorder.startPhase();
+            mySetts->fInterpreterFactory = createInterpreterDSPFactoryFromFile(fileToCompile, argc, argv, error);
+            recorder.endPhase(kCompilePhase);
             
-        }
-        //toCompile->fLLVMFactory = readDSPFactoryFromMachineFile(irFile); // in progress but still does not work reliably for all DSP...
-
-        //----Create DSP Factory
-        if (!toCompile->fLLVMFactory) {
+            if (!mySetts->fInterpreterFactory) {
+                errorMsg = error.c_str();
+                delete toCompile;
+                delete mySetts;
+                return qMakePair(QString(""), (void*)NULL);
+            }
+            
+            mySetts->fSoundfileInterface = new SoundUI(mySetts->fInterpreterFactory->getIncludePathnames(), -1, nullptr, hasCompileOption(mySetts->fInterpreterFactory, "-double"));
             
-            // New allocation
+            // The expansion is reused by the LLVM pass only if its dependencies are known
+            recorder.startPhase();
+            writeDependencies(getDependencies(mySetts->fInterpreterFactory), shaKey.c_str());
+            recorder.endPhase(kDependenciesPhase);
+            
+        } else if (cached) {
+            recorder.setTier("cached");
+            delete toCompile;
+            toCompile = cached->fFactory;
+            mySetts->fSoundfileInterface = cached->fSoundfileInterface;
+            mySetts->fCacheEntry = cached;
+        } else {
+        
+            //----Use the native code saved for this machine if possible, then the IR
+            bool fromMachineCode = false;
         #ifdef LLVM_DSP_FACTORY
-            toCompile->fLLVMFactory = createPolyDSPFactoryFromFile(fileToCompile, argc, argv, "", error, optLevel);
-        #else
-            toCompile->fLLVMFactory = createInterpreterDSPFactoryFromFile(fileToCompile, argc, argv, error);
-        #endif
+            bool useMachineCode = settings.fMachineCodeCache;
+            string machineFile = getMachineCodeFile(factoryFolder, shaKey.c_str(), optLevel).toStdString();
             
-            if (settings) {
-                settings->setValue("InputNumber", 0);
-                settings->setValue("OutputNumber", 0);
+            if (useMachineCode && QFileInfo(machineFile.c_str()).exists()) {
+                recorder.startPhase();
+                if (checkMachineCodeFile(machineFile.c_str(), shaKey.c_str())) {
+                    toCompile->fLLVMFactory = readPolyDSPFactoryFromMachineFile(machineFile, "", error);
+                }
+                recorder.endPhase(kMachineCodeReadPhase);
+                
+                if (toCompile->fLLVMFactory) {
+                    recorder.setTier("machine code");
+                    fromMachineCode = true;
+                } else {
+                    // Corrupted or unreadable file : it will be rewritten from the IR or the source
+                    removeMachineCodeFile(machineFile.c_str());
+                    error = "";
+                }
             }
+        #endif
             
-            if (toCompile->fLLVMFactory) {
+            if (!toCompile->fLLVMFactory && QFileInfo(irFile.c_str()).exists()) {
+                recorder.startPhase();
+            #ifdef LLVM_DSP_FACTORY
+                toCompile->fLLVMFactory = readPolyDSPFactoryFromBitcodeFile(irFile, "", error, optLevel);
+            #else
+                toCompile->fLLVMFactory = NULL;  // TODO
+            #endif
+                recorder.endPhase(kBitcodeReadPhase);
+                recorder.setTier("bitcode");
+            }
+
+            //----Create DSP Factory
+            if (!toCompile->fLLVMFactory) {
                 
+                // New allocation
+                recorder.setTier("source");
+                recorder.startPhase();
             #ifdef LLVM_DSP_FACTORY
-                writePolyDSPFactoryToBitcodeFile(static_cast<dsp_poly_factory*>(toCompile->fLLVMFactory), irFile);
+                toCompile->fLLVMFactory = createPolyDSPFactoryFromFile(fileToCompile, argc, argv, "", error, optLevel);
             #else
-               // TODO
+                toCompile->fLLVMFactory = createInterpreterDSPFactoryFromFile(fileToCompile, argc, argv, error);
             #endif
-                //writeDSPFactoryToMachineFile(toCompile->fLLVMFactory, irFile); // in progress but still does not work reliably for all DSP...
-                writeDependencies(getDependencies(toCompile->fLLVMFactory), shaKey.c_str());
-                if (error != "") {
-                    FLErrorWindow::_Instance()->print_Error(error.c_str());
+                recorder.endPhase(kCompilePhase);
+                
+                if (settings.fWindow) {
+                    mySetts->fInputNumber = 0;
+                    mySetts->fOutputNumber = 0;
+                }
+                
+                if (toCompile->fLLVMFactory) {
+                    
+                    recorder.startPhase();
+                #ifdef LLVM_DSP_FACTORY
+                    writePolyDSPFactoryToBitcodeFile(static_cast<dsp_poly_factory*>(toCompile->fLLVMFactory), irFile);
+                #else
+                   // TODO
+                #endif
+                    recorder.endPhase(kBitcodeWritePhase);
+                    recorder.startPhase();
+                    writeDependencies(getDependencies(toCompile->fLLVMFactory), shaKey.c_str());
+                    recorder.endPhase(kDependenciesPhase);
+                    if (error != "") {
+                        emit this->error(error.c_str());
+                    }
+                } else {
+                    errorMsg = error.c_str();
+                    delete toCompile;
+                    delete mySetts;
+                    return qMakePair(QString(""), (void*)NULL);
                 }
-            } else {
-                errorMsg = error.c_str();
-			    return qMakePair(QString(""), (void*)NULL);
             }
+            
+        #ifdef LLVM_DSP_FACTORY
+            //----The next load of this SHA key skips the LLVM code generation
+            if (useMachineCode && !fromMachineCode) {
+                recorder.startPhase();
+                writeMachineCodeFile(toCompile->fLLVMFactory, machineFile.c_str(), shaKey.c_str());
+                recorder.endPhase(kMachineCodeWritePhase);
+            }
+        #endif
+            
+            // Create SoundUI manager using pathnames
+            mySetts->fSoundfileInterface = new SoundUI(toCompile->fLLVMFactory->getIncludePathnames(), -1, nullptr, hasCompileOption(toCompile->fLLVMFactory, "-double"));
+            
+            factoryCacheEntry* entry = new factoryCacheEntry();
+            entry->fFactory = toCompile;
+            entry->fSoundfileInterface = mySetts->fSoundfileInterface;
+            entry->fKey = cacheKey;
+            entry->fIRBytes = QFileInfo(irFile.c_str()).size();
+            insertCachedFactory(entry);
+            mySetts->fCacheEntry = entry;
         }
-        
-        // Create SoundUI manager using pathnames
-        mySetts->fSoundfileInterface = new SoundUI(toCompile->fLLVMFactory->getIncludePathnames(), -1, nullptr, hasCompileOption(toCompile->fLLVMFactory, "-double"));
     }
 //------ Compile remote factory
-    else if (settings) {
+    else if (settings.fWindow) {
 #ifdef REMOTE
         mySetts->fType = TYPE_REMOTE;
         
-        string ip_server = settings->value("RemoteProcessing/MachineIP", "127.0.0.1").toString().toStdString();
-        int port_server = settings->value("RemoteProcessing/MachinePort", 7777).toInt();
+        string ip_server = settings.fMachineIP.toStdString();
+        int port_server = settings.fMachinePort;
      
         std::vector<std::pair<std::string, std::string> > factories_list;
          
@@ -235,8 +395,11 @@ QPair<QString, void*> FLSessionManager::createFactory(const QString& source, FLW
         // Possible cleanup
         deleteRemoteDSPFactory(toCompile->fRemoteFactory);
         // New allocation
+        recorder.setTier("remote");
+        recorder.startPhase();
         toCompile->fRemoteFactory = createRemoteDSPFactoryFromString(name.toStdString(), pathToContent(fileToCompile.c_str()).toStdString(), 
                                         argc, argv, ip_server, port_server, error, optLevel);
+        recorder.endPhase(kCompilePhase);
         
         if (!toCompile->fRemoteFactory) {
             errorMsg = error.c_str();
@@ -245,8 +408,8 @@ QPair<QString, void*> FLSessionManager::createFactory(const QString& source, FLW
         
         // SL : 26/08/15 : deactived for now
         /*
-        settings->setValue("InputNumber", toCompile->fRemoteFactory->getNumInputs());
-        settings->setValue("OutputNumber", toCompile->fRemoteFactory->getNumOutputs());
+        mySetts->fInputNumber = toCompile->fRemoteFactory->getNumInputs();
+        mySetts->fOutputNumber = toCompile->fRemoteFactory->getNumOutputs();
         */
 #endif
     }
@@ -261,27 +424,70 @@ QPair<QString, void*> FLSessionManager::createFactory(const QString& source, FLW
     mySetts->fFactory = toCompile;
     mySetts->fPath = path;
     mySetts->fName = name;
+    mySetts->fSHAKey = shaKey.c_str();
+    
+//----- Registered while the SHA key is locked : the folder can not be evicted in between
+    fLiveSHAKeysMutex.lock();
+    fLiveSHAKeys[mySetts->fSHAKey]++;
+    fLiveSHAKeysMutex.unlock();
+    
+//----- The IR and native code may have been written in the folder
+    fSHACache->updateSize(shaKey.c_str());
+    recorder.setSuccess(true);
     
 //----- If a post-compilation script option is set : execute it !
-    if (settings && settings->value("Script/Options", "").toString() != "") {
+    if (settings.fWindow && !interpreterTier && settings.fScriptOptions != "") {
         QString erroMsg;
-        if (!executeInstruction(settings->value("Script/Options", "").toString(), errorMsg)) {
-            FLErrorWindow::_Instance()->print_Error(errorMsg);
+        if (!executeInstruction(settings.fScriptOptions, errorMsg)) {
+            emit this->error(errorMsg);
         }
     }
     
     return qMakePair(QString(shaKey.c_str()), (void*)(mySetts));
 }
 
+void FLSessionManager::applyFactorySettings(QPair<QString, void*> factorySetts, FLWinSettings* settings)
+{
+    factorySettings* mySetts = (factorySettings*)(factorySetts.second);
+    
+    if (!mySetts || !settings) {
+        return;
+    }
+    
+    if (mySetts->fInputNumber >= 0) {
+        settings->setValue("InputNumber", mySetts->fInputNumber);
+    }
+    if (mySetts->fOutputNumber >= 0) {
+        settings->setValue("OutputNumber", mySetts->fOutputNumber);
+    }
+}
+
 #ifdef REMOTE
 remote_audio* audio = NULL;
 #endif
 
-static bool hasMIDISync(dsp* dsp)
+static std::string getJSON(dsp* dsp)
 {
     JSONUI jsonui;
     dsp->buildUserInterface(&jsonui);
-    std::string json = jsonui.JSON();
+    return jsonui.JSON();
+}
+
+// Control zones of a DSP, in the order of buildUserInterface
+struct FLControlZones : public GenericUI
+{
+    std::vector<FAUSTFLOAT*> fZones;
+    
+    virtual void addButton(const char* label, FAUSTFLOAT* zone) { fZones.push_back(zone); }
+    virtual void addCheckButton(const char* label, FAUSTFLOAT* zone) { fZones.push_back(zone); }
+    virtual void addVerticalSlider(const char* label, FAUSTFLOAT* zone, FAUSTFLOAT init, FAUSTFLOAT min, FAUSTFLOAT max, FAUSTFLOAT step) { fZones.push_back(zone); }
+    virtual void addHorizontalSlider(const char* label, FAUSTFLOAT* zone, FAUSTFLOAT init, FAUSTFLOAT min, FAUSTFLOAT max, FAUSTFLOAT step) { fZones.push_back(zone); }
+    virtual void addNumEntry(const char* label, FAUSTFLOAT* zone, FAUSTFLOAT init, FAUSTFLOAT min, FAUSTFLOAT max, FAUSTFLOAT step) { fZones.push_back(zone); }
+};
+
+static bool hasMIDISync(dsp* dsp)
+{
+    std::string json = getJSON(dsp);
     
     return ((json.find("midi") != std::string::npos) &&
             ((json.find("start") != std::string::npos) ||
@@ -309,10 +515,15 @@ dsp* FLSessionManager::createDSP(QPair<QString, void*> factorySetts, const QStri
         bool polyphony = settings->value("Polyphony/Enabled", FLSettings::_Instance()->value("General/Control/PolyphonyDefaultChecked", false)).toBool();
         bool group = settings->value("Polyphony/GroupEnabled", FLSettings::_Instance()->value("General/Control/PolyphonyGroupDefaultChecked", true)).toBool();
         bool midi = settings->value("MIDI/Enabled", FLSettings::_Instance()->value("General/Control/MIDIDefaultChecked", false)).toBool();
-        bool is_double = hasCompileOption(toCompile->fLLVMFactory, "-double");
+        bool is_double = hasCompileOption((mySetts->fInterpreterFactory) ? (dsp_factory*)mySetts->fInterpreterFactory : (dsp_factory*)toCompile->fLLVMFactory, "-double");
         
+        // Interpreter tier : monophonic instance, until the LLVM factory is ready
+        if (mySetts->fInterpreterFactory) {
+            compiledDSP = mySetts->fInterpreterFactory->createDSPInstance();
+            if (is_double) compiledDSP = new dsp_sample_adapter<double, float>(compiledDSP);
+        }
         // For polyphony support
-        if (polyphony) {
+        else if (polyphony) {
             compiledDSP = toCompile->fLLVMFactory->createPolyDSPInstance(atoi(voices.c_str()), midi, group, is_double);
         } else {
             // 'synchronized_dsp' to remove as soon as soundfile change is automatically synchronized inside the DSP
@@ -375,7 +586,7 @@ dsp* FLSessionManager::createDSP(QPair<QString, void*> factorySetts, const QStri
         if (!compiledDSP) {
             //----- If the factory is seen as already compiled but it disapeared, it has to be recompiled
             if (errorToCatch == ERROR_FACTORY_NOTFOUND) {
-                QPair<QString, void*> fS = createFactory(source, settings, errorMsg);
+                QPair<QString, void*> fS = createFactory(source, getCompileSettings(settings), errorMsg);
                 if (!fS.second) {
                     errorMsg = "Impossible to find and recompile factory";
                     return NULL;
@@ -411,31 +622,278 @@ dsp* FLSessionManager::createDSP(QPair<QString, void*> factorySetts, const QStri
     return compiledDSP;
 }
 
+//The controls are copied in the order of buildUserInterface : both DSP must have the same JSON
+bool FLSessionManager::copyControls(dsp* newDSP, dsp* currentDSP)
+{
+    if (getJSON(newDSP) != getJSON(currentDSP)) {
+        return false;
+    }
+    
+    FLControlZones newZones;
+    FLControlZones currentZones;
+    newDSP->buildUserInterface(&newZones);
+    currentDSP->buildUserInterface(&currentZones);
+    
+    if (newZones.fZones.size() != currentZones.fZones.size()) {
+        return false;
+    }
+    
+    for (size_t i = 0; i < newZones.fZones.size(); i++) {
+        *newZones.fZones[i] = *currentZones.fZones[i];
+    }
+    
+    return true;
+}
+
 // Factory and instances are associated not to have to maintain both from the ouside of the session manager
 void FLSessionManager::deleteDSPandFactory(dsp* toDeleteDSP)
 {
     factorySettings* factoryToDelete = fDSPToFactory[toDeleteDSP];
     fDSPToFactory.remove(toDeleteDSP);
     
-    if (factoryToDelete->fType == TYPE_LOCAL) {
-        delete toDeleteDSP;
-    #ifdef LLVM_DSP_FACTORY
-        delete factoryToDelete->fFactory->fLLVMFactory;
-    #else
-        deleteInterpreterDSPFactory(static_cast<interpreter_dsp_factory*>(factoryToDelete->fFactory->fLLVMFactory));
-    #endif
-        factoryToDelete->fFactory->fLLVMFactory = NULL;
+    delete toDeleteDSP;
+    releaseFactory(factoryToDelete);
+}
+
+void FLSessionManager::deleteFactory(QPair<QString, void*> factorySetts)
+{
+    releaseFactory((factorySettings*)(factorySetts.second));
+}
+
+//------------------- SHA keys of the expanded sources ----------------------
+
+//The SHA key only depends on the code, the name and the compilation arguments (including the include folders)
+QString FLSessionManager::getExpansionKey(const QString& name, const QString& faustContent, int argc, const char** argv)
+{
+    string expansionString = name.toStdString() + "\n";
+    
+    for (int i = 0; i < argc; i++) {
+        expansionString += string(argv[i]) + " ";
+    }
+    
+    expansionString += "\n" + faustContent.toStdString();
+    return FL_generate_sha1(expansionString).c_str();
+}
+
+//The key saved by writeExpansionSHAKey is valid as long as the libraries of the DSP did not change since then
+QString FLSessionManager::readExpansionSHAKey(const QString& expansionKey)
+{
+    QString keyFile = fSessionFolder + "/SHAKeys/" + expansionKey;
+    QFileInfo keyInfo(keyFile);
+    
+    if (!keyInfo.exists()) {
+        return "";
+    }
+    
+    QString shaKey = pathToContent(keyFile).trimmed();
+    
+    // The dependencies are written with the first compilation of the SHA key
+    if (shaKey == "" || !QFileInfo(fSessionFolder + "/SHAFolder/" + shaKey + "/" + shaKey + ".ini").exists()) {
+        return "";
+    }
+    
+    QVector<QString> dependencies = readDependencies(shaKey);
+    
+    for (int i = 0; i < dependencies.size(); i++) {
+        QFileInfo dependency(dependencies[i]);
+        
+        if (!dependency.exists() || dependency.lastModified() > keyInfo.lastModified()) {
+            return "";
+        }
+    }
+    
+    return shaKey;
+}
+
+void FLSessionManager::writeExpansionSHAKey(const QString& expansionKey, const QString& shaKey)
+{
+    QString keysFolder = fSessionFolder + "/SHAKeys";
+    QDir().mkpath(keysFolder);
+    writeFile(keysFolder + "/" + expansionKey, shaKey);
+}
+
+//The keys which SHA folder was evicted are useless : they are removed with it.
+//A key written just before the creation of its folder may be removed too, the source is then expanded once more
+void FLSessionManager::pruneExpansionSHAKeys()
+{
+    QDir keysFolder(fSessionFolder + "/SHAKeys");
+    QStringList keyFiles = keysFolder.entryList(QDir::Files);
+    
+    for (QStringList::iterator it = keyFiles.begin(); it != keyFiles.end(); it++) {
+        
+        QString keyFile = keysFolder.absoluteFilePath(*it);
+        QString shaKey = pathToContent(keyFile).trimmed();
+        
+        if (shaKey == "" || !QFileInfo(fSessionFolder + "/SHAFolder/" + shaKey).exists()) {
+            QFile::remove(keyFile);
+        }
+    }
+}
+
+//------------------- Machine code cache ----------------------
+
+//The native code is only valid for the CPU target and the libfaust/LLVM build that generated it : both are part of the file name.
+//A mismatch simply misses the file and the factory is rebuilt from the IR
+QString FLSessionManager::getMachineCodeFile(const QString& factoryFolder, const QString& shaKey, int optLevel)
+{
+    string machineKey = getDSPMachineTarget() + " " + getCLibFaustVersion() + " " + QString::number(optLevel).toStdString();
+    return factoryFolder + "/" + shaKey + "-" + QString(FL_generate_sha1(machineKey).c_str()).left(12) + ".mc";
+}
+
+//SHA1 of the content of the native code file, empty if it can not be read
+static QString machineCodeDigest(const QString& machineFile)
+{
+    QFile file(machineFile);
+    
+    if (!file.open(QIODevice::ReadOnly)) {
+        return "";
+    }
+    
+    QByteArray content = file.readAll();
+    return FL_generate_sha1(string(content.constData(), content.size())).c_str();
+}
+
+//Written aside then renamed, so that an interrupted write never leaves a truncated file to load.
+//The digest of the file and the SHA key of the DSP are saved next to it, in <file>.sha1
+void FLSessionManager::writeMachineCodeFile(dsp_poly_factory* factory, const QString& machineFile, const QString& shaKey)
+{
+#ifdef LLVM_DSP_FACTORY
+    QString tmpFile = machineFile + ".tmp";
+    QFile::remove(tmpFile);
+    
+    writePolyDSPFactoryToMachineFile(factory, tmpFile.toStdString(), "");
+    
+    QString digest = machineCodeDigest(tmpFile);
+    
+    if (digest != "") {
+        removeMachineCodeFile(machineFile);
+        QFile::rename(tmpFile, machineFile);
+        writeFile(machineFile + ".sha1", digest + "\n" + shaKey + "\n");
+    }
+#else
+    Q_UNUSED(factory);
+    Q_UNUSED(machineFile);
+    Q_UNUSED(shaKey);
+#endif
+}
+
+//Native code is loaded without any check by LLVM : the file has to be the one written for this SHA key, and complete
+bool FLSessionManager::checkMachineCodeFile(const QString& machineFile, const QString& shaKey)
+{
+    if (!QFileInfo(machineFile + ".sha1").exists()) {
+        return false;
+    }
+    
+    QStringList checksum = pathToContent(machineFile + ".sha1").split("\n", QString::SkipEmptyParts);
+    
+    return checksum.size() == 2 && checksum[1] == shaKey && checksum[0] == machineCodeDigest(machineFile);
+}
+
+void FLSessionManager::removeMachineCodeFile(const QString& machineFile)
+{
+    QFile::remove(machineFile);
+    QFile::remove(machineFile + ".sha1");
+}
+
+//------------------- Factory cache ----------------------
+
+//The caller owns a new reference on the returned entry
+factoryCacheEntry* FLSessionManager::acquireCachedFactory(const QString& key)
+{
+    QMutexLocker locker(&fFactoryCacheMutex);
+    
+    factoryCacheEntry* entry = fFactoryCache.value(key, NULL);
+    
+    if (entry) {
+        entry->fRefCount++;
+        fFactoryCacheStats.fHits++;
+    } else {
+        fFactoryCacheStats.fMisses++;
+    }
+    
+    return entry;
+}
+
+void FLSessionManager::insertCachedFactory(factoryCacheEntry* entry)
+{
+    QMutexLocker locker(&fFactoryCacheMutex);
+    
+    entry->fRefCount = 1;
+    fFactoryCache[entry->fKey] = entry;
+    fFactoryCacheStats.fIRBytes += entry->fIRBytes;
+}
+
+//The factory itself is deleted with its last reference
+void FLSessionManager::releaseFactory(factorySettings* factoryToDelete)
+{
+    if (!factoryToDelete) {
+        return;
+    }
+    
+    fLiveSHAKeysMutex.lock();
+    if (--fLiveSHAKeys[factoryToDelete->fSHAKey] <= 0) {
+        fLiveSHAKeys.remove(factoryToDelete->fSHAKey);
+    }
+    fLiveSHAKeysMutex.unlock();
+    
+    if (factoryToDelete->fCacheEntry) {
+        
+        factoryCacheEntry* entry = factoryToDelete->fCacheEntry;
+        bool lastReference = false;
+        
+        fFactoryCacheMutex.lock();
+        if (--entry->fRefCount == 0) {
+            fFactoryCache.remove(entry->fKey);
+            fFactoryCacheStats.fIRBytes -= entry->fIRBytes;
+            lastReference = true;
+        }
+        fFactoryCacheMutex.unlock();
+        
+        if (lastReference) {
+        #ifdef LLVM_DSP_FACTORY
+            delete entry->fFactory->fLLVMFactory;
+        #else
+            deleteInterpreterDSPFactory(static_cast<interpreter_dsp_factory*>(entry->fFactory->fLLVMFactory));
+        #endif
+            delete entry->fSoundfileInterface;
+            delete entry->fFactory;
+            delete entry;
+        }
+    }
+    else if (factoryToDelete->fInterpreterFactory) {
+        deleteInterpreterDSPFactory(factoryToDelete->fInterpreterFactory);
         delete factoryToDelete->fSoundfileInterface;
-        factoryToDelete->fSoundfileInterface = NULL;
+        delete factoryToDelete->fFactory;
     }
 #ifdef REMOTE
-    else {
-        //deleteRemoteDSPInstance((remote_dsp*)toDeleteDSP);
-        delete toDeleteDSP;
+    else if (factoryToDelete->fType == TYPE_REMOTE) {
         deleteRemoteDSPFactory(factoryToDelete->fFactory->fRemoteFactory);
-        factoryToDelete->fFactory->fRemoteFactory = NULL;
+        delete factoryToDelete->fFactory;
     }
 #endif
+    
+    delete factoryToDelete;
+}
+
+bool FLSessionManager::hasCachedFactory(const QString& key)
+{
+    QMutexLocker locker(&fFactoryCacheMutex);
+    return fFactoryCache.contains(key);
+}
+
+bool FLSessionManager::isInterpreterFactory(QPair<QString, void*> factorySetts)
+{
+    factorySettings* mySetts = (factorySettings*)(factorySetts.second);
+    return mySetts && mySetts->fInterpreterFactory;
+}
+
+factoryCacheStats FLSessionManager::getFactoryCacheStats()
+{
+    QMutexLocker locker(&fFactoryCacheMutex);
+    
+    factoryCacheStats stats = fFactoryCacheStats;
+    stats.fEntries = fFactoryCache.size();
+    return stats;
 }
 
 //--- Managing Faust Source to obtain a name and a Faust program as a string ---
@@ -537,7 +995,7 @@ QString FLSessionManager::ifUrlToString(const QString& source)
 //--Local params
 
 // TODO: string memory management....
-const char** FLSessionManager::getFactoryArgv(const QString& sourcePath, const QString& faustOptions, QSettings* settings, int& argc)
+const char** FLSessionManager::getFactoryArgv(const QString& sourcePath, const QString& faustOptions, const compileSettings* settings, int& argc)
 {
     //--------Compilation Options 
     int numberFixedParams = 4;
@@ -607,15 +1065,13 @@ const char** FLSessionManager::getFactoryArgv(const QString& sourcePath, const Q
     // Polyphonic support
     if (settings) {
         argv[iteratorParams++] = "-poly";
-        argv[iteratorParams++] = (settings->value("Polyphony/Enabled", 
-            FLSettings::_Instance()->value("General/Control/PolyphonyDefaultChecked", false)).toBool()) ? "1": "0";
+        argv[iteratorParams++] = (settings->fPolyphony) ? "1": "0";
             
         argv[iteratorParams++] = "-voices";
-        argv[iteratorParams++] = strdup(settings->value("Polyphony/Voice", "4").toString().toStdString().c_str());
+        argv[iteratorParams++] = strdup(settings->fVoices.toStdString().c_str());
         
         argv[iteratorParams++] = "-group";
-        argv[iteratorParams++] = (settings->value("Polyphony/GroupEnabled", 
-            FLSettings::_Instance()->value("General/Control/PolyphonyGroupDefaultChecked", false)).toBool()) ? "1": "0";
+        argv[iteratorParams++] = (settings->fGroup) ? "1": "0";
     }
 
     argv[argc] = 0; // NULL terminated argv
@@ -782,22 +1238,96 @@ void FLSessionManager::updateFolderDate(const QString& shaValue)
 {
     QString shaFolder = fSessionFolder + "/SHAFolder/" + shaValue;
     touchFolder(shaFolder);
+    fSHACache->touch(shaValue);
 }
 
-void FLSessionManager::cleanSHAFolder()
+void FLSessionManager::lockSHAKey(const QString& shaKey)
 {
-    QString shaFolder = fSessionFolder + "/SHAFolder";
-    QDir shaDir(shaFolder);
-    QFileInfoList children = shaDir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Time);
-    
-    if (children.size() > kMaxSHAFolders) {
-        for (QFileInfoList::iterator it = children.begin(); it != children.end(); it++) {
-            if (it == (children.end()-1)){
-                QString childToDelete = it->absoluteFilePath();
-                deleteDirectoryAndContent(childToDelete);
-            }
+    fSHALocksMutex.lock();
+    
+    shaKeyLock*& shaLock = fSHALocks[shaKey];
+    if (!shaLock) {
+        shaLock = new shaKeyLock();
+    }
+    shaLock->fUsers++;
+    
+    fSHALocksMutex.unlock();
+    
+    shaLock->fMutex.lock();
+}
+
+void FLSessionManager::unlockSHAKey(const QString& shaKey)
+{
+    QMutexLocker locker(&fSHALocksMutex);
+    
+    shaKeyLock* shaLock = fSHALocks[shaKey];
+    shaLock->fMutex.unlock();
+    
+    if (--shaLock->fUsers == 0) {
+        fSHALocks.remove(shaKey);
+        delete shaLock;
+    }
+}
+
+//The candidates are evicted in order until the folder is back under its target : the skipped ones do not count.
+//The victims are locked like a compilation would, then deleted once fSHALocksMutex is released :
+//the compilations of these SHA keys wait for the end of the deletion, the other ones go on
+void FLSessionManager::cleanSHAFolder(qint64 budget)
+{
+    QStringList candidates = fSHACache->evictionCandidates(budget, kMaxSHAFolders);
+    QStringList victims;
+    
+    fSHALocksMutex.lock();
+    
+    for (int i = 0; i < candidates.size() && fSHACache->isAboveTarget(budget, kMaxSHAFolders); i++) {
+        
+        // Being compiled right now, or a factory of this SHA key is still alive
+        if (fSHALocks.contains(candidates[i]) || isSHAKeyInUse(candidates[i])) {
+            continue;
+        }
+        
+        shaKeyLock* shaLock = new shaKeyLock();
+        shaLock->fUsers = 1;
+        shaLock->fMutex.lock();
+        fSHALocks[candidates[i]] = shaLock;
+        
+        fSHACache->remove(candidates[i]);
+        victims.push_back(candidates[i]);
+    }
+    
+    fSHALocksMutex.unlock();
+    
+    if (victims.isEmpty()) {
+        return;
+    }
+    
+    for (QStringList::iterator it = victims.begin(); it != victims.end(); it++) {
+        deleteDirectoryAndContent(fSessionFolder + "/SHAFolder/" + *it);
+        unlockSHAKey(*it);
+    }
+    
+    fSHACache->save();
+    pruneExpansionSHAKeys();
+}
+
+bool FLSessionManager::isSHAKeyInUse(const QString& shaKey)
+{
+    {
+        QMutexLocker locker(&fLiveSHAKeysMutex);
+        if (fLiveSHAKeys.contains(shaKey)) {
+            return true;
         }
     }
+    
+    QMutexLocker locker(&fFactoryCacheMutex);
+    
+    for (QMap<QString, factoryCacheEntry*>::iterator it = fFactoryCache.begin(); it != fFactoryCache.end(); it++) {
+        if (it.key().startsWith(shaKey + "-")) {
+            return true;
+        }
+    }
+    
+    return false;
 }
 
 //Saving the sources of the windows in their designated folders
@@ -958,6 +1488,7 @@ void FLSessionManager::copySHAFolder(const QString& snapshotFolder)
     for (it = children.begin(); it != children.end(); it++) {
         QString destinationFolder = shaFolder + "/" +  it->baseName();
         cpDir(it->absoluteFilePath(), destinationFolder);
+        fSHACache->updateSize(it->baseName());
     }
 }
 
@@ -1061,6 +1592,9 @@ void FLSessionManager::createSnapshot(const QString& snapshotFolder)
         dstDir.mkdir(dstFolder);
         
         cpDir(srcFolder, dstFolder);
+        
+        // The snapshot can be recalled as long as it exists : its SHA key is not evicted
+        fSHACache->pin(shaSF, snapshotFolder);
     }
     
     generalSettings->endGroup();
@@ -1110,25 +1644,31 @@ QVector<QString> FLSessionManager::readDependencies(const QString& shaValue)
 {
     QVector<QString> dependencies;
     QString shaPath = fSessionFolder + "/SHAFolder/" + shaValue + "/" + shaValue + ".ini";
-    QSettings* settings = new QSettings(shaPath, QSettings::IniFormat);
-    QStringList groups = settings->childKeys();
+    QSettings settings(shaPath, QSettings::IniFormat);
     
-    for (int i = 0; i < groups.size(); i++) {
-        QString dependency = settings->value(QString::number(i), "").toString();
+    // The files written before the Count key only had the dependencies
+    int count = settings.value("Count", settings.childKeys().size()).toInt();
+    
+    for (int i = 0; i < count; i++) {
+        QString dependency = settings.value(QString::number(i), "").toString();
         dependencies.push_back(dependency);
     }
     
     return dependencies;
 }
 
+//The file is written even without dependency : readExpansionSHAKey only trusts the SHA keys that have one
 void FLSessionManager::writeDependencies(QVector<QString> dependencies, const QString& shaValue)
 {
     QString shaPath = fSessionFolder + "/SHAFolder/" + shaValue + "/" + shaValue + ".ini";
-    QSettings* settings = new QSettings(shaPath, QSettings::IniFormat);
+    QSettings settings(shaPath, QSettings::IniFormat);
     
+    settings.clear();
     for (int i = 0; i < dependencies.size(); i++) {
-        settings->setValue(QString::number(i), dependencies[i]);
+        settings.setValue(QString::number(i), dependencies[i]);
     }
+    settings.setValue("Count", dependencies.size());
+    settings.sync();
 }
 
 //---------------------PUBLISH FACTORIES ON LOCAL SERVER------------------
@@ -17,9 +17,12 @@
 //          - Graphics.rc : file saving the graphical parameters of the last DSP contained in the window
 //          - Connections.jc : file saving the last known Jack connections of the window
 //          - SHAKey.dsp : copy of the Faust code of the last DSP contained in the window
+// - SHAKeys : files named after the source, name and options of a DSP, containing the SHA key of its expansion
+// - SHAIndex.ini : size, last use and pinning of the DSP-specific folders (see FLSHAFolderCache)
 // - SHAFolder : folder containing the DSP-specific folders
 //      - SHAKey = DSP-specific folder
 //          – SHAKey* : LLVM intermediate representation of the DSP 
+//          – SHAKey-target.mc* : native code of the DSP, for a given CPU target, libfaust version and optimization level
 //          – SHAKey.dsp*: copy of the Faust code corresponding to this SHAKey 
 //          – SHAKey-svg* : folder containing the svg diagram resources
 
@@ -53,9 +56,8 @@ typedef int (*remoteDSPErrorCallback) (int error_code, void* arg);
 #ifdef LLVM_DSP_FACTORY
 #include "faust/dsp/llvm-dsp.h"
 struct dsp_poly_factory;
-#else
-#include "faust/dsp/interpreter-dsp.h"
 #endif
+#include "faust/dsp/interpreter-dsp.h"
 
 #include "TMutex.h"
 #include <iostream>
@@ -91,6 +93,7 @@ class synchronized_dsp : public decorator_dsp, public TLockAble {
 };
 
 class FLWinSettings;
+class FLSHAFolderCache;
 
 using namespace std;
 
@@ -113,17 +116,88 @@ union factory {
     }
 };
 
-struct factorySettings {
+// A local factory shared by all the windows compiling the same SHA key (and optimization level)
+struct factoryCacheEntry {
     factory*        fFactory;
-    QString         fPath;
-    QString         fName;
-    int             fType;
     SoundUI*        fSoundfileInterface;
+    QString         fKey;
+    int             fRefCount;      // One reference per factorySettings pointing to the entry
+    qint64          fIRBytes;       // Size of the bitcode file (IR size) : not the memory used by the factory once JIT compiled
+    
+    factoryCacheEntry()
+    {
+        fFactory = NULL;
+        fSoundfileInterface = NULL;
+        fRefCount = 0;
+        fIRBytes = 0;
+    }
+};
+
+struct factoryCacheStats {
+    int             fHits;
+    int             fMisses;
+    int             fEntries;
+    qint64          fIRBytes;       // Size of the bitcode files of the cached factories on disk (not their JIT compiled memory)
+    
+    factoryCacheStats()
+    {
+        fHits = 0;
+        fMisses = 0;
+        fEntries = 0;
+        fIRBytes = 0;
+    }
+};
+
+// Everything createFactory reads in the settings. It is copied in the GUI thread (see getCompileSettings) : the compilation threads do not touch the QSettings
+struct compileSettings {
+    bool                fWindow;            // The factory is compiled for a window, otherwise only the general settings are used
+    QString             fFaustOptions;
+    int                 fOptLevel;
+    QString             fMachineName;
+    QString             fMachineIP;
+    int                 fMachinePort;
+    bool                fPolyphony;
+    QString             fVoices;
+    bool                fGroup;
+    QString             fPath;
+    QString             fExportOptions;
+    QString             fScriptOptions;
+    bool                fMachineCodeCache;
+    qint64              fSHAFolderBudget;   // In bytes
+    
+    compileSettings()
+    {
+        fWindow = false;
+        fOptLevel = -1;
+        fMachinePort = 0;
+        fPolyphony = false;
+        fGroup = false;
+        fMachineCodeCache = false;
+        fSHAFolderBudget = 0;
+    }
+};
+
+// One factorySettings is returned by each createFactory call. It owns one reference on its cache entry, if any
+struct factorySettings {
+    factory*            fFactory;
+    QString             fPath;
+    QString             fName;
+    QString             fSHAKey;
+    int                 fType;
+    SoundUI*            fSoundfileInterface;
+    factoryCacheEntry*  fCacheEntry;
+    interpreter_dsp_factory* fInterpreterFactory;   // Interpreter tier, not shared
+    int                 fInputNumber;       // To save in the window settings (see applyFactorySettings), -1 if unchanged
+    int                 fOutputNumber;
     
     factorySettings()
     {
         fFactory = NULL;
         fSoundfileInterface = NULL;
+        fCacheEntry = NULL;
+        fInterpreterFactory = NULL;
+        fInputNumber = -1;
+        fOutputNumber = -1;
     }
 };
 
@@ -159,7 +233,7 @@ class FLSessionManager : public QObject
         
         void            copySHAFolder(const QString& snapshotFolder);
         
-        const char**    getFactoryArgv(const QString& sourcePath, const QString& faustOptions, QSettings* settings, int& argc);
+        const char**    getFactoryArgv(const QString& sourcePath, const QString& faustOptions, const compileSettings* settings, int& argc);
         
         const char**    getRemoteInstanceArgv(QSettings* winSettings, int& argc);
         void            deleteArgv(int argc, const char** argv);
@@ -181,7 +255,53 @@ class FLSessionManager : public QObject
         QMap<QString, remote_dsp_factory*>  fPublishedFactories;
     #endif
     
-        void cleanSHAFolder();
+    //--Factories can be compiled from several threads (see FLFactoryCompiler)
+    //----Two compilations of the same SHA key must not write in the same folder at the same time
+    //----A lock only exists while compilations use it : the SHA keys that have one are not evicted
+        struct shaKeyLock {
+            QMutex  fMutex;
+            int     fUsers;     // Compilations holding or waiting for the lock
+            
+            shaKeyLock() : fUsers(0) {}
+        };
+    
+        QMutex                      fSHALocksMutex;
+        QMap<QString, shaKeyLock*>  fSHALocks;
+        void            lockSHAKey(const QString& shaKey);
+        void            unlockSHAKey(const QString& shaKey);
+    
+        friend class    FLSHAKeyLocker;
+    
+    //--Keeps the SHAFolder within its byte budget (General/Compilation/SHAFolderBudget, in MB)
+        FLSHAFolderCache*           fSHACache;
+        void cleanSHAFolder(qint64 budget);
+        bool isSHAKeyInUse(const QString& shaKey);
+    
+    //--Factories alive, by SHA key : local, interpreter or remote, whether a window uses them yet or not
+        QMutex                      fLiveSHAKeysMutex;
+        QMap<QString, int>          fLiveSHAKeys;
+    
+    //--SHA keys of the sources already expanded, saved in the SHAKeys folder of the session
+        QString         getExpansionKey(const QString& name, const QString& faustContent, int argc, const char** argv);
+        QString         readExpansionSHAKey(const QString& expansionKey);
+        void            writeExpansionSHAKey(const QString& expansionKey, const QString& shaKey);
+        void            pruneExpansionSHAKeys();
+    
+    //--Native code of the local factories, saved aside the IR in the SHA folder
+        QString         getMachineCodeFile(const QString& factoryFolder, const QString& shaKey, int optLevel);
+        void            writeMachineCodeFile(dsp_poly_factory* factory, const QString& machineFile, const QString& shaKey);
+        bool            checkMachineCodeFile(const QString& machineFile, const QString& shaKey);
+        void            removeMachineCodeFile(const QString& machineFile);
+    
+    //--Local factories are shared between the DSP of the same SHA key and destroyed with their last reference
+        QMutex                              fFactoryCacheMutex;
+        QMap<QString, factoryCacheEntry*>   fFactoryCache;
+        factoryCacheStats                   fFactoryCacheStats;
+    
+        bool                hasCachedFactory(const QString& key);
+        factoryCacheEntry*  acquireCachedFactory(const QString& key);
+        void                insertCachedFactory(factoryCacheEntry* entry);
+        void                releaseFactory(factorySettings* factorySetts);
         
         QVector<QString> getDependencies(dsp_factory* factoryDependency);
         
@@ -205,7 +325,14 @@ class FLSessionManager : public QObject
         bool generateAuxFiles(const QString& shaKey, const QString& sourcePath, const QString& faustOptions, const QString& name, QString& error);
         bool generateSVG(const QString& shaKey, const QString& sourcePath, const QString& svgPath, const QString& name, QString& errorMsg);
         
-        QPair<QString, void*> createFactory(const QString& source, FLWinSettings* settings, QString& errorMsg);
+    //--The settings of a compilation, read in the GUI thread. settings may be NULL
+        compileSettings getCompileSettings(FLWinSettings* settings);
+    
+    //--With interpreterFirst, an interpreter factory may be returned when the LLVM one would take time to compile (see isInterpreterFactory)
+        QPair<QString, void*> createFactory(const QString& source, const compileSettings& settings, QString& errorMsg, bool interpreterFirst = false);
+    
+    //--Writes in the window settings what the compilation thread could not (GUI thread)
+        void applyFactorySettings(QPair<QString, void*> factorySetts, FLWinSettings* settings);
         
         dsp* createDSP(QPair<QString, void*> factorySetts, 
                         const QString& source, FLWinSettings* settings,
@@ -214,6 +341,17 @@ class FLSessionManager : public QObject
                         QString& errorMsg);
 
         void deleteDSPandFactory(dsp* toDeleteDSP);
+    
+    //The DSP replacing the one of an interpreter factory goes on with its controls when their interfaces are the same
+        bool copyControls(dsp* newDSP, dsp* currentDSP);
+    
+    //A factory that was created but never instanciated (its compilation was cancelled for example)
+        void deleteFactory(QPair<QString, void*> factorySetts);
+    
+        factoryCacheStats   getFactoryCacheStats();
+    
+    //The DSP of an interpreter factory has to be replaced by an LLVM one
+        bool                isInterpreterFactory(QPair<QString, void*> factorySetts);
         
         QString             getExpandedVersion(QSettings* settings, const QString& source);
         
@@ -15,6 +15,8 @@
 
 #include "faust/gui/QTUI.h"
 #include "faust/gui/httpdUI.h"
+#include "faust/gui/JSONUI.h"
+#include "faust/gui/APIUI.h"
 #include "faust/gui/FUI.h"
 #include "faust/gui/OSCUI.h"
 
@@ -38,10 +40,9 @@
 #include "FLInterfaceManager.h"
 #include "FLToolBar.h"
 #include "FLServerHttp.h"
-
-#ifdef REMOTE
+#include "FLOscBundler.h"
+#include "FLOscServer.h"
 #include "FLStatusBar.h"
-#endif
 
 #include "AudioCreator.h"
 #include "AudioManager.h"
@@ -49,6 +50,7 @@
 #include "FLSettings.h"
 #include "FLWinSettings.h"
 #include "FLSessionManager.h"
+#include "FLFactoryCompiler.h"
 #include "FLExportManager.h"
 #include "FLFileWatcher.h"
 #include "FLErrorWindow.h"
@@ -98,7 +100,9 @@ FLWindow::FLWindow(QString& baseName, int index, const QString& home, FLWinSetti
     
     fHttpdWindow = NULL;
     fHttpInterface = NULL;
+    fHttpZones = NULL;
     fOscInterface = NULL;
+    fOscZones = NULL;
     fMIDIInterface = NULL;
     fMIDIHandler = NULL;
  
@@ -108,6 +112,18 @@ FLWindow::FLWindow(QString& baseName, int index, const QString& home, FLWinSetti
     
     fToolBar = NULL;
     
+    fCompileTicket = 0;
+    fUpgradeTicket = 0;
+    fFadingDSP = NULL;
+    fFadingTicket = 0;
+    fFadingInterpreter = false;
+    fFadingUpgrade = false;
+    fFadeTimer = new QTimer(this);
+    connect(fFadeTimer, SIGNAL(timeout()), this, SLOT(checkFade()));
+    
+    connect(FLFactoryCompiler::_Instance(), SIGNAL(factoryCompiled(int, const QString&, void*, const QString&)),
+            this, SLOT(factoryCompiled(int, const QString&, void*, const QString&)));
+    
     // Creating Window Folder
     fHome = home;
     
@@ -120,12 +136,17 @@ FLWindow::FLWindow(QString& baseName, int index, const QString& home, FLWinSetti
     // Set Menu & ToolBar
     fLastMigration = QDateTime::currentDateTime();
     set_ToolBar();
-#ifdef REMOTE
     fStatusBar = NULL;
     set_StatusBar();
+#ifdef REMOTE
     connect(this, SIGNAL(remoteCnxLost(int)), this, SLOT(RemoteCallback(int)));
 #endif
     set_MenuBar(appMenus);
+    
+    // DSP load displayed in the status bar
+    fLoadTimer = new QTimer(this);
+    connect(fLoadTimer, SIGNAL(timeout()), this, SLOT(updateDSPLoad()));
+    fLoadTimer->start(kLoadRefreshRate);
 }
 
 FLWindow::~FLWindow()
@@ -187,7 +208,8 @@ void FLWindow::start_stop_watcher(bool on)
 //Initialization of User Interface + StartUp of Audio Client
 //@param : init = if the window created is a default window.
 //@param : error = in case init fails, the error is filled
-bool FLWindow::init_Window(int init, const QString& source, QString& errorMsg)
+//@param : factorySetts = factory already compiled for source (session restoration), otherwise it is compiled here
+bool FLWindow::init_Window(int init, const QString& source, QString& errorMsg, QPair<QString, void*> factorySetts)
 {
     fSource = source;
     
@@ -199,17 +221,22 @@ bool FLWindow::init_Window(int init, const QString& source, QString& errorMsg)
         fWavSource = source;
     }
     
-    FLMessageWindow::_Instance()->displayMessage("Compiling DSP...");
-    FLMessageWindow::_Instance()->show();
-    FLMessageWindow::_Instance()->raise();
-    
     FLSessionManager* sessionManager = FLSessionManager::_Instance();
-    QPair<QString, void*> factorySetts = sessionManager->createFactory(source, fSettings, errorMsg);
-    FLMessageWindow::_Instance()->hide();
+    
+    if (!factorySetts.second) {
+        FLMessageWindow::_Instance()->displayMessage("Compiling DSP...");
+        FLMessageWindow::_Instance()->show();
+        FLMessageWindow::_Instance()->raise();
+    
+        factorySetts = sessionManager->createFactory(source, sessionManager->getCompileSettings(fSettings), errorMsg);
+        FLMessageWindow::_Instance()->hide();
+    }
     
     if (!factorySetts.second) { // testing if the factory pointer is null (= the compilation failed)
         return false;
     }
+    
+    sessionManager->applyFactorySettings(factorySetts, fSettings);
   	
     if (!init_audioClient(errorMsg)) {
         return false;
@@ -325,18 +352,14 @@ void FLWindow::selfUpdate()
 //            update_Window(fSource);
 //    }
 //    else
-    QString wavform = fWavSource;
-    update_Window(fSource);
-    fWavSource = wavform;
+    update_Window(fSource, true);
 }
 
 void FLWindow::selfNameUpdate(const QString& oldSource, const QString& newSource)
 {
  //    In case name update is concerning source
     if (oldSource == fSource) {
-        QString wavform = fWavSource;
-        update_Window(newSource);
-        fWavSource = wavform;
+        update_Window(newSource, true);
 //    In case name update concerns a dependency
     } else {
         QString errorMsg = "WARNING : "+ fWindowName+". " + oldSource + " has been renamed as " + newSource + ". The dependency might be broken ! ";
@@ -344,9 +367,11 @@ void FLWindow::selfNameUpdate(const QString& oldSource, const QString& newSource
     }
 }
 
-//Modification of the process in the window
+//Modification of the process in the window. The factory is compiled in the background (see FLFactoryCompiler),
+//the current DSP keeps running until factoryCompiled swaps it
 //@param : source = source that reemplaces the current one
-bool FLWindow::update_Window(const QString& source)
+//@param : keepWavSource = the waveform file the current source was generated from is kept
+int FLWindow::update_Window(const QString& source, bool keepWavSource)
 {
     
 //    bool update = false;
@@ -367,109 +392,179 @@ bool FLWindow::update_Window(const QString& source)
     
 //    if(update){
         
-    float saveW = 0.0;
-    float saveH = 0.0;
+    QString sourceToCompile = source;
+    QString wavsource = "";
+
+    if (ifWavToString(sourceToCompile, wavsource)) {
+        sourceToCompile = wavsource;
+        wavsource = source;
+    } else if (keepWavSource) {
+        wavsource = fWavSource;
+    }
     
-    float newW = 0.0;
-    float newH = 0.0;
+    // A newer source replaces the one that may still be compiling
+    FLFactoryCompiler::_Instance()->cancel(fCompileTicket);
     
-    if (fInterface) {
-        saveW = fInterface->minimumSizeHint().width();
-        saveH = fInterface->minimumSizeHint().height();
+    fCompiledSource = sourceToCompile;
+    fCompiledWavSource = wavsource;
+    // Edit-save-listen : the interpreter plays the new source while LLVM compiles it
+    bool interpreterFirst = fSettings->value("Compilation/InterpreterFirst", FLSettings::_Instance()->value("General/Compilation/InterpreterFirst", false)).toBool();
+    fCompileTicket = FLFactoryCompiler::_Instance()->compile(sourceToCompile, fSettings, interpreterFirst);
+    fUpgradeTicket = 0;
+    
+    setWindowTitle(fWindowName + " : " + getName() + " (compiling...)");
+    return fCompileTicket;
+}
+
+//The compilation launched in update_Window is over : the new DSP replaces the current one through a crossfade
+void FLWindow::factoryCompiled(int ticket, const QString& shaKey, void* factory, const QString& compilationError)
+{
+    // The result is meant for another window
+    if (ticket != fCompileTicket) {
+        return;
     }
     
-    start_stop_watcher(false);
+    fCompileTicket = 0;
     
-    FLMessageWindow::_Instance()->displayMessage("Updating DSP...");
-    FLMessageWindow::_Instance()->show();
-    FLMessageWindow::_Instance()->raise();
-    hide();
-  
-    QString savedName = fSettings->value("Name", "").toString();
-    QString savedPath = fSettings->value("Path", "").toString();
-    QString savedSHA = fSettings->value("SHA", "").toString();
+    // The LLVM pass of an update already reported with the interpreter DSP
+    bool upgrade = (ticket == fUpgradeTicket);
+    fUpgradeTicket = 0;
+    
+    // A newer DSP is ready before the end of the previous crossfade
+    endFade(true);
+    
+    start_stop_watcher(false);
     
     saveWindow();
-    hide();
  
-    QString errorMsg("");
+    QString errorMsg(compilationError);
     FLSessionManager* sessionManager = FLSessionManager::_Instance();
-    QString sourceToCompile = source;
-    QString wavsource = "";
-
-    if (ifWavToString(sourceToCompile, wavsource)) {
-        sourceToCompile = wavsource;
-        wavsource = source;
-    }
 
-    QPair<QString, void*> factorySetts = sessionManager->createFactory(sourceToCompile, fSettings, errorMsg);
+    QPair<QString, void*> factorySetts = qMakePair(shaKey, factory);
     bool isUpdateSucessfull = factorySetts.second;
+    bool interpreterTier = sessionManager->isInterpreterFactory(factorySetts);
     
     if (isUpdateSucessfull) {
         
+        sessionManager->applyFactorySettings(factorySetts, fSettings);
+        
         //creating the new DSP instance
-        dsp* new_dsp = sessionManager->createDSP(factorySetts, source, fSettings, remoteDSPCallback, this, errorMsg);
-         
-        if (new_dsp) {
+        dsp* new_dsp = sessionManager->createDSP(factorySetts, fCompiledSource, fSettings, remoteDSPCallback, this, errorMsg);
+        
+        if (!new_dsp) {
+            sessionManager->deleteFactory(factorySetts);
+            isUpdateSucessfull = false;
+        } else {
             
             QString newName = fSettings->value("Name", "").toString();
             
-            if (fAudioManager->init_FadeAudio(errorMsg, newName.toStdString().c_str(), new_dsp)) {
+            if (!fAudioManager->init_FadeAudio(errorMsg, newName.toStdString().c_str(), new_dsp)) {
+                sessionManager->deleteDSPandFactory(new_dsp);
+                isUpdateSucessfull = false;
+            } else {
                 
                 fIsDefault = false;
         
-                recall_Window();
-                
-                // Start crossfade and wait for its end
-                fAudioManager->start_Fade();
-                fAudioManager->wait_EndFade();
-                
-                // Switch the current DSP as the dropped one
-                dsp* old_dsp = fCurrentDSP;
-                fCurrentDSP = new_dsp;
-                
-                // Delete old dsp (and remove it from MIDI interface)
-                FLSessionManager::_Instance()->deleteDSPandFactory(old_dsp);
-                deleteInterfaces();
+                // The LLVM DSP goes on where the interpreter one is
+                if (!upgrade || !sessionManager->copyControls(new_dsp, fCurrentDSP)) {
+                    recall_Window();
+                }
                 
-                // Set the new interface & Recall the parameters of the window
-                allocateInterfaces(newName);
+                // Length and shape of the crossfade
+                FLSettings* generalSettings = FLSettings::_Instance();
+                fAudioManager->set_FadeParameters(fSettings->value("Fade/Duration", generalSettings->value("General/Audio/FadeDuration", kDefaultFadeDuration)).toFloat(),
+                                                  fSettings->value("Fade/Curve", generalSettings->value("General/Audio/FadeCurve", kLinearFade)).toInt());
                 
-                buildInterfaces(new_dsp);
+                // The crossfade is polled : the DSP are swapped in endFade, once the audio thread does not use the old one anymore
+                fFadingDSP = new_dsp;
+                fFadingTicket = ticket;
+                fFadingSource = fCompiledSource;
+                fFadingWavSource = fCompiledWavSource;
+                fFadingInterpreter = interpreterTier;
+                fFadingUpgrade = upgrade;
+                fFadingSize = (fInterface) ? fInterface->minimumSizeHint() : QSize();
                 
-                fSource = sourceToCompile;
-                fWavSource = wavsource;
-                    
-                //Launch User Interface
-                runInterfaces();
+                fAudioManager->start_Fade();
+                fFadeClock.start();
+                fFadeTimer->start(kFadePollRate);
+                return;
             }
         }
     }
     
     start_stop_watcher(true);
+    setWindowTitle(fWindowName + " : " + getName());
+    errorPrint(errorMsg);
     
-    if (isUpdateSucessfull) {
-        emit windowNameChanged();
-    } else {
-        errorPrint(errorMsg);
+    // The interpreter DSP simply goes on if the LLVM pass failed
+    if (!upgrade) {
+        emit updateDone(ticket, isUpdateSucessfull, errorMsg);
     }
+}
 
-    FLMessageWindow::_Instance()->hide();
+void FLWindow::checkFade()
+{
+    endFade(fFadeClock.elapsed() > fAudioManager->get_FadeTimeOut());
+}
+
+//Once the crossfade is over, the interfaces are rebuilt on the new DSP. With force, the crossfade is stopped where it is
+//Returns false if the crossfade is not over yet
+bool FLWindow::endFade(bool force)
+{
+    if (!fFadingDSP) {
+        return true;
+    }
     
-    if (fInterface) {
-        newW = fInterface->minimumSizeHint().width();
-        newH = fInterface->minimumSizeHint().height();
+    if (!fAudioManager->end_Fade(force)) {
+        return false;
     }
- 
+    
+    fFadeTimer->stop();
+    FLSessionManager* sessionManager = FLSessionManager::_Instance();
+    
+    // Switch the current DSP as the dropped one
+    dsp* old_dsp = fCurrentDSP;
+    fCurrentDSP = fFadingDSP;
+    fFadingDSP = NULL;
+    
+    fSource = fFadingSource;
+    fWavSource = fFadingWavSource;
+    
+    // The interfaces (MIDI, OSC, HTTP) write in the zones of the old dsp from their own threads : they are deleted first
+    deleteInterfaces();
+    sessionManager->deleteDSPandFactory(old_dsp);
+    
+    // Set the new interface & Recall the parameters of the window
+    allocateInterfaces(fSettings->value("Name", "").toString());
+    
+    buildInterfaces(fCurrentDSP);
+        
+    //Launch User Interface
+    runInterfaces();
+    
+    start_stop_watcher(true);
+    
+    // The interpreter DSP is replaced through the same crossfade once the LLVM factory is compiled, unless a newer source is compiling
+    if (fFadingInterpreter && !fCompileTicket) {
+        fCompiledSource = fSource;
+        fCompiledWavSource = fWavSource;
+        fCompileTicket = FLFactoryCompiler::_Instance()->compile(fCompiledSource, fSettings);
+        fUpgradeTicket = fCompileTicket;
+    }
+    
+    emit windowNameChanged();
+    
 // 2 cases : 
 //    1- Updating with a new DSP --> adjusting Size to the new interface
 //    2- Self Updating --> keeping the window as it is (could have been opened or shred)
-    if (newH != saveH || newW != saveW) {
+    if (fInterface && fInterface->minimumSizeHint() != fFadingSize) {
         adjustSize();
     }
-
-    show();
-    return isUpdateSucessfull;
+    
+    if (!fFadingUpgrade) {
+        emit updateDone(fFadingTicket, true, "");
+    }
+    return true;
 }
 
 //Reaction to source deletion
@@ -728,18 +823,44 @@ void FLWindow::resizingBig()
 
 void FLWindow::set_StatusBar()
 {
-#ifdef REMOTE
     fStatusBar = new FLStatusBar(fSettings, this);
+#ifdef REMOTE
     connect(fStatusBar, SIGNAL(switchMachine()), this, SLOT(redirectSwitch()));
-    setStatusBar(fStatusBar);
 #endif
+    setStatusBar(fStatusBar);
+}
+
+//Load of the audio callback since the previous call, also published by the drop server (/stats/load)
+void FLWindow::updateDSPLoad()
+{
+    if (!fClientOpen || !fAudioManager) {
+        fStatusBar->clearDSPLoad();
+        return;
+    }
+    
+    AudioLoad load;
+    fAudioManager->get_Load(load);
+    
+    fStatusBar->setDSPLoad(load.fAverage, load.fPeak, load.fXruns, load.fOverBudget);
+    FLServerHttp::_Instance()->declareDSPLoad(fWindowName.toStdString(), getName().toStdString(), load.fAverage, load.fPeak, load.fXruns, load.fOverBudget);
 }
 
 //Redirection machine switch
 void FLWindow::redirectSwitch()
 {
 #ifdef REMOTE
-    if (!update_Window(fSource)) {
+    connect(this, SIGNAL(updateDone(int, bool, const QString&)), this, SLOT(redirectSwitchDone(int, bool)), Qt::UniqueConnection);
+    update_Window(fSource);
+#endif
+}
+
+//The machine switch is effective once the compilation is over
+void FLWindow::redirectSwitchDone(int /*ticket*/, bool success)
+{
+#ifdef REMOTE
+    disconnect(this, SIGNAL(updateDone(int, bool, const QString&)), this, SLOT(redirectSwitchDone(int, bool)));
+    
+    if (!success) {
         fStatusBar->remoteFailed();
     }
 #endif
@@ -777,7 +898,8 @@ bool FLWindow::resetAudioDSPInterfaces()
 {
     QString errorMsg;
     FLSessionManager* sessionManager = FLSessionManager::_Instance();
-    QPair<QString, void*> factorySetts = sessionManager->createFactory(fSource, fSettings, errorMsg);
+    QPair<QString, void*> factorySetts = sessionManager->createFactory(fSource, sessionManager->getCompileSettings(fSettings), errorMsg);
+    sessionManager->applyFactorySettings(factorySetts, fSettings);
   
     float saveW = 0.0;
     float saveH = 0.0;
@@ -844,7 +966,7 @@ void FLWindow::updateMIDIInterface()
         fCurrentDSP->buildUserInterface(fMIDIInterface);
         recall_Window();
         fMIDIInterface->run();
-        FLInterfaceManager::_Instance()->registerGUI(fMIDIInterface);
+        FLInterfaceManager::_Instance()->registerGUI(fMIDIInterface, this);
         setWindowsOptions();
     }
 }
@@ -853,8 +975,8 @@ void FLWindow::allocateMIDIInterface()
 {
 #ifdef JACK
     JA_audioManager* manager = dynamic_cast<JA_audioManager*>(fAudioManager);
-    // Special case for JACK audio manager
-    if (manager) {
+    // Special case for JACK audio manager (the shared client has no MIDI ports)
+    if (manager && !manager->isSharedClient()) {
         fMIDIHandler = manager->getAudioFader();
     } else {
         fMIDIHandler = new rt_midi(fWindowName.toStdString());
@@ -868,7 +990,7 @@ void FLWindow::allocateMIDIInterface()
 void FLWindow::deleteMIDIInterface()
 {
     if (fMIDIInterface) {
-        FLInterfaceManager::_Instance()->unregisterGUI(fMIDIInterface);
+        FLInterfaceManager::_Instance()->unregisterGUI(fMIDIInterface, this);
         delete fMIDIInterface;
         fMIDIInterface = NULL;
         // rt_midi handler has to be deallocated, JA_audioFader one is kept and deallocated JA_audioManager
@@ -886,9 +1008,15 @@ void catch_OSCError(void* arg)
     win->disableOSCInterface();
 }
         
-//Allocation of Interfaces
+//Allocation of Interfaces. The OSC modes (shared port, bundles) are read here : changing them only affects the interfaces created afterwards
 void FLWindow::allocateOscInterface()
 {
+    // In shared mode, the messages are received by FLOscServer and the zones are sent by FLOscBundler
+    if (FLOscServer::isEnabled()) {
+        fOscZones = new APIUI();
+        return;
+    }
+    
     int argc = 11; 
     
 //---- Allocation for windows needs
@@ -899,7 +1027,8 @@ void FLWindow::allocateOscInterface()
     string inport = fSettings->value("Osc/InPort", "5510").toString().toStdString();
     argv[2] = (char*) (inport.c_str());
     argv[3] = (char*)"-xmit";
-    argv[4] = (char*)"1";
+    // In bundle mode, the zones are transmitted by FLOscBundler
+    argv[4] = (char*)(FLOscBundler::isEnabled() ? "0" : "1");
     argv[5] = (char*)"-outport";
     string outport = fSettings->value("Osc/OutPort", "5511").toString().toStdString();
     argv[6] = (char*) (outport.c_str());
@@ -914,15 +1043,46 @@ void FLWindow::allocateOscInterface()
 
     fOscInterface = new OSCUI(argv[0], argc, argv, NULL, &catch_OSCError, this, false);
     delete [] argv;
+    
+    if (FLOscBundler::isEnabled()) {
+        fOscZones = new APIUI();
+    }
 }
 
 void FLWindow::deleteOscInterface()
 {
     if (fOscInterface) {
-        FLInterfaceManager::_Instance()->unregisterGUI(fOscInterface);
+        FLInterfaceManager::_Instance()->unregisterGUI(fOscInterface, this);
         delete fOscInterface;
         fOscInterface = NULL;
     }
+    
+    if (fOscZones) {
+        FLOscBundler::_Instance()->unregisterZones(this);
+        FLOscServer::_Instance()->unregisterZones(fWindowName.toStdString());
+        delete fOscZones;
+        fOscZones = NULL;
+    }
+}
+
+//The bundles are sent where the OSC interface would send its messages.
+//In shared mode, the addresses of the window are prefixed with its name, on both ways
+void FLWindow::runOscZones()
+{
+    if (fOscInterface) {
+        FLOscBundler::_Instance()->registerZones(fOscZones, this, fOscInterface->getDestAddress(), fOscInterface->getUDPOut());
+        return;
+    }
+    
+    if (!FLOscServer::_Instance()->registerZones(fWindowName.toStdString(), fOscZones)) {
+        errorPrint("The shared OSC port could not be opened");
+        disableOSCInterface();
+        return;
+    }
+    
+    string dest = fSettings->value("Osc/DestHost", "localhost").toString().toStdString();
+    int outport = fSettings->value("Osc/OutPort", "5511").toInt();
+    FLOscBundler::_Instance()->registerZones(fOscZones, this, dest, outport, "/" + fWindowName.toStdString());
 }
 
 void FLWindow::updateOSCInterface()
@@ -930,10 +1090,20 @@ void FLWindow::updateOSCInterface()
     saveWindow();
     deleteOscInterface();
     allocateOscInterface();
-    fCurrentDSP->buildUserInterface(fOscInterface);
+    if (fOscInterface) {
+        fCurrentDSP->buildUserInterface(fOscInterface);
+    }
+    if (fOscZones) {
+        fCurrentDSP->buildUserInterface(fOscZones);
+    }
     recall_Window();
-    fOscInterface->run();
-    FLInterfaceManager::_Instance()->registerGUI(fOscInterface);
+    if (fOscInterface) {
+        fOscInterface->run();
+        FLInterfaceManager::_Instance()->registerGUI(fOscInterface, this);
+    }
+    if (fOscZones) {
+        runOscZones();
+    }
     setWindowsOptions();
 }
 
@@ -977,6 +1147,8 @@ bool FLWindow::allocateInterfaces(const QString& nameEffect)
 //Building QT Interface | Osc Interface | Parameter saving Interface | ToolBar
 void FLWindow::buildInterfaces(dsp* compiledDSP)
 {
+    FLInterfaceManager::_Instance()->registerZones(compiledDSP, this);
+    
     if (fInterface) {
         compiledDSP->buildUserInterface(fInterface);
     }
@@ -988,11 +1160,19 @@ void FLWindow::buildInterfaces(dsp* compiledDSP)
     if (fHttpInterface) {
         compiledDSP->buildUserInterface(fHttpInterface);  
     }
+    
+    if (fHttpZones) {
+        compiledDSP->buildUserInterface(fHttpZones);
+    }
    
     if (fOscInterface) {
         compiledDSP->buildUserInterface(fOscInterface);
     }
     
+    if (fOscZones) {
+        compiledDSP->buildUserInterface(fOscZones);
+    }
+    
     if (fMIDIInterface) {
         compiledDSP->buildUserInterface(fMIDIInterface);
     }
@@ -1002,23 +1182,30 @@ void FLWindow::runInterfaces()
 {
     if (fHttpInterface) {
         fHttpInterface->run();
-        FLServerHttp::_Instance()->declareHttpInterface(fHttpInterface->getTCPPort(), getName().toStdString());
+    }
+    
+    if (fHttpZones) {
+        declareHttpInterface();
     }
 
     if (fOscInterface) {
         fOscInterface->run();
-        FLInterfaceManager::_Instance()->registerGUI(fOscInterface);
+        FLInterfaceManager::_Instance()->registerGUI(fOscInterface, this);
+    }
+    
+    if (fOscZones) {
+        runOscZones();
     }
     
     if (fMIDIInterface) {
         fMIDIInterface->run();
-        FLInterfaceManager::_Instance()->registerGUI(fMIDIInterface);
+        FLInterfaceManager::_Instance()->registerGUI(fMIDIInterface, this);
     }
     
     if (fInterface) {
         //fInterface->run();
         fInterface->installEventFilter(this);
-        FLInterfaceManager::_Instance()->registerGUI(fInterface);
+        FLInterfaceManager::_Instance()->registerGUI(fInterface, this);
     }
 
     setWindowsOptions();
@@ -1027,8 +1214,10 @@ void FLWindow::runInterfaces()
 //Delete of QTinterface and of saving graphical interface
 void FLWindow::deleteInterfaces()
 {
+    FLInterfaceManager::_Instance()->unregisterZones(this);
+    
     if (fInterface) {
-        FLInterfaceManager::_Instance()->unregisterGUI(fInterface);
+        FLInterfaceManager::_Instance()->unregisterGUI(fInterface, this);
         delete fInterface;
         fInterface = NULL;
     }
@@ -1084,11 +1273,37 @@ void FLWindow::closeEvent(QCloseEvent* event)
 	event->accept();
 }
 
+//Hidden or minimized windows are refreshed at a lower rate by FLInterfaceManager
+void FLWindow::changeEvent(QEvent* event)
+{
+    if (event->type() == QEvent::WindowStateChange) {
+        FLInterfaceManager::_Instance()->setVisible(this, isVisible() && !isMinimized());
+    }
+    
+    QMainWindow::changeEvent(event);
+}
+
+void FLWindow::showEvent(QShowEvent* event)
+{
+    FLInterfaceManager::_Instance()->setVisible(this, !isMinimized());
+    QMainWindow::showEvent(event);
+}
+
+void FLWindow::hideEvent(QHideEvent* event)
+{
+    FLInterfaceManager::_Instance()->setVisible(this, false);
+    QMainWindow::hideEvent(event);
+}
+
 //During the execution, when a window is shut, its associate folder has to be removed
 void FLWindow::shutWindow()
 {
+    int pendingTicket = fCompileTicket;
     closeWindow();
     const QString winFolder = fHome + "/Windows/" + fWindowName;
+    
+    // The pending compilation works on a copy of the settings
+    FLFactoryCompiler::_Instance()->cancel(pendingTicket);
     delete fSettings;
     deleteDirectoryAndContent(winFolder);
 }
@@ -1097,9 +1312,18 @@ void FLWindow::shutWindow()
 void FLWindow::closeWindow()
 {
     hide();
+    
+    // A compilation that was not over is dropped in shutWindow or when the application quits
+    disconnect(FLFactoryCompiler::_Instance(), SIGNAL(factoryCompiled(int, const QString&, void*, const QString&)),
+               this, SLOT(factoryCompiled(int, const QString&, void*, const QString&)));
+    
+    endFade(true);
     start_stop_watcher(false);
     fSettings->sync();
     
+    fLoadTimer->stop();
+    FLServerHttp::_Instance()->removeDSPLoad(fWindowName.toStdString());
+    
     if (fClientOpen && fAudioManager) {
         fAudioManager->stop();
     }
@@ -1109,13 +1333,13 @@ void FLWindow::closeWindow()
         fHttpdWindow = NULL;
     }
     
-    FLSessionManager::_Instance()->deleteDSPandFactory(fCurrentDSP);
+    FLInterfaceManager::_Instance()->unregisterOwner(this);
+    
+    // The interfaces, possibly used by the drop server threads, are deleted before the zones of the DSP
     deleteInterfaces();
+    FLSessionManager::_Instance()->deleteDSPandFactory(fCurrentDSP);
 
-#ifdef REMOTE
     delete fStatusBar;
-#endif
-
     delete fAudioManager;
     delete fToolBar;
     
@@ -1243,6 +1467,9 @@ void FLWindow::stop_Audio()
     //    }
     
 #endif
+    // The audio of a pending crossfade is stopped on the new DSP
+    endFade(true);
+    
     if (fClientOpen) {
         fAudioManager->stop();
         fClientOpen = false;
@@ -1407,6 +1634,14 @@ int FLWindow::calculate_Coef()
 
 void FLWindow::allocateHttpInterface()
 {
+    // The zones are declared to the drop server for its push channel.
+    // In single port mode, the window is controlled through the server and no httpd is started
+    fHttpZones = new APIUI();
+    
+    if (FLServerHttp::_Instance()->isSinglePort()) {
+        return;
+    }
+    
     QString windowTitle = fWindowName + ":" + getName();
     int argc = 3;
     char* argv[4];  // NULL terminated argv
@@ -1430,6 +1665,12 @@ void FLWindow::deleteHttpInterface()
         delete fHttpInterface;
         fHttpInterface = NULL;
     }
+    
+    if (fHttpZones) {
+        FLServerHttp::_Instance()->removeWindowInterface(fWindowName.toStdString());
+        delete fHttpZones;
+        fHttpZones = NULL;
+    }
 }
 
 void FLWindow::updateHttpInterface()
@@ -1437,13 +1678,49 @@ void FLWindow::updateHttpInterface()
     saveWindow();
     deleteHttpInterface();
     allocateHttpInterface();
-    fCurrentDSP->buildUserInterface(fHttpInterface);
-    recall_Window();
-    fHttpInterface->run();
-    FLServerHttp::_Instance()->declareHttpInterface(fHttpInterface->getTCPPort(), getName().toStdString());
+    
+    fCurrentDSP->buildUserInterface(fHttpZones);
+    
+    if (fHttpInterface) {
+        fCurrentDSP->buildUserInterface(fHttpInterface);
+        recall_Window();
+        fHttpInterface->run();
+    } else {
+        recall_Window();
+    }
+    
+    declareHttpInterface();
     setWindowsOptions();
 }
 
+//Like the one of httpdUI, the description tells where the interface is served : the address and the port are inserted first
+string FLWindow::httpJSON(const QString& name, int port)
+{
+    JSONUI json(name.toStdString(), "", fCurrentDSP->getNumInputs(), fCurrentDSP->getNumOutputs());
+    fCurrentDSP->buildUserInterface(&json);
+    
+    string description = json.JSON();
+    string location = "\n\t\"address\": \"" + searchLocalIP().toStdString() + "\",\n\t\"port\": \"" + QString::number(port).toStdString() + "\",";
+    
+    size_t begin = description.find('{');
+    if (begin != string::npos) {
+        description.insert(begin + 1, location);
+    }
+    
+    return description;
+}
+
+//The drop server answers <port>/JSON (or <window>/JSON in single port mode) with this description, until the DSP is replaced
+void FLWindow::declareHttpInterface()
+{
+    int dropPort = FLSettings::_Instance()->value("General/Network/HttpDropPort", 7777).toInt();
+    FLServerHttp::_Instance()->declareWindowInterface(fWindowName.toStdString(), getName().toStdString(), fHttpZones, httpJSON(fWindowName, dropPort));
+    
+    if (fHttpInterface) {
+        FLServerHttp::_Instance()->declareHttpInterface(fHttpInterface->getTCPPort(), getName().toStdString(), httpJSON(getName(), fHttpInterface->getTCPPort()));
+    }
+}
+
 void FLWindow::switchHttp(bool on)
 {
     if (on) {
@@ -1457,7 +1734,7 @@ void FLWindow::viewQRCode()
 {
     if (!fIsDefault) {
         
-        if (!fHttpInterface) {
+        if (!fHttpInterface && !fHttpZones) {
             fToolBar->switchHttp(true);
         }
         
@@ -1471,7 +1748,9 @@ void FLWindow::viewQRCode()
         
         if (fHttpdWindow) {
             int dropPort = FLSettings::_Instance()->value("General/Network/HttpDropPort", 7777).toInt();
-            QString fullUrl = "http://" + searchLocalIP() + ":" + QString::number(dropPort) + "/" + QString::number(fHttpInterface->getTCPPort());
+            QString fullUrl = "http://" + searchLocalIP() + ":" + QString::number(dropPort) + "/";
+            // In single port mode, the drop zone wrapping the interface of the window is served at /<window>
+            fullUrl += (fHttpInterface) ? QString::number(fHttpInterface->getTCPPort()) : fWindowName;
             fInterface->displayQRCode(fullUrl, fHttpdWindow);
             fHttpdWindow->move(calculate_Coef()*10, 0);
             QString windowTitle = fWindowName + ":" + fSettings->value("Name", "").toString().toStdString().c_str();
@@ -1504,6 +1783,11 @@ void FLWindow::exportToPNG()
 
 QString FLWindow::get_HttpUrl() 
 {
+    if (fHttpZones && !fHttpInterface) {
+        int dropPort = FLSettings::_Instance()->value("General/Network/HttpDropPort", 7777).toInt();
+        return "http://" + searchLocalIP() + ":" + QString::number(dropPort) + "/" + fWindowName + "/";
+    }
+    
     return (fHttpInterface) ? ("http://" + searchLocalIP() + ":" + QString::number(fHttpInterface->getTCPPort()) + "/") : "";
 }
 
@@ -29,7 +29,11 @@
 
 #include "faust/midi/rt-midi.h"
 
+#define kLoadRefreshRate 1000   // ms
+#define kFadePollRate 10        // ms
+
 class httpdUI;
+class APIUI;
 class QTGUI;
 class FLToolBar;
 class FLStatusBar;
@@ -73,6 +77,8 @@ class FLWindow : public QMainWindow
     //--- Handle status
         FLStatusBar*    fStatusBar;
         void            set_StatusBar();
+    
+        QTimer*         fLoadTimer;
 
     //--- Handle menus
         QMenu*          fWindowMenu;
@@ -92,18 +98,23 @@ class FLWindow : public QMainWindow
         FUI*            fRCInterface;       //Graphical parameters saving interface
 
         OSCUI*          fOscInterface;      //OSC interface
+        APIUI*          fOscZones;          //Zones sent by FLOscBundler and received by FLOscServer, in bundle or shared mode
     
         MidiUI*         fMIDIInterface;     //MIDI interface
         midi_handler*   fMIDIHandler;       //RTMIDI midi-handler
       
         httpdUI*        fHttpInterface;     //Httpd interface for distance control      
+        APIUI*          fHttpZones;         //Same thing through the drop server, in single port mode
         HTTPWindow*     fHttpdWindow;       //Supporting QRcode and httpd address
 
         void            allocateOscInterface();
         void            deleteOscInterface();
+        void            runOscZones();
 
 		void            allocateHttpInterface();
         void            deleteHttpInterface();
+        void            declareHttpInterface();
+        std::string     httpJSON(const QString& name, int port);
         
         void            allocateMIDIInterface();
     
@@ -116,6 +127,25 @@ class FLWindow : public QMainWindow
     //--- CURRENT DSP Instance
         dsp*            fCurrentDSP;
     
+    //--- Background compilation of the next DSP (see FLFactoryCompiler)
+        int             fCompileTicket;         //0 if no compilation is pending
+        int             fUpgradeTicket;         //Of the LLVM pass replacing an interpreter DSP, 0 otherwise
+        QString         fCompiledSource;
+        QString         fCompiledWavSource;
+    
+    //--- Crossfade towards the compiled DSP, polled so that the GUI thread is not blocked
+        QTimer*         fFadeTimer;
+        QElapsedTimer   fFadeClock;
+        dsp*            fFadingDSP;             //NULL if no crossfade is pending
+        int             fFadingTicket;
+        QString         fFadingSource;
+        QString         fFadingWavSource;
+        bool            fFadingInterpreter;     //The LLVM factory is compiled once the crossfade is over
+        bool            fFadingUpgrade;         //LLVM pass : the update was already reported with the interpreter DSP
+        QSize           fFadingSize;            //Of the interface before the update
+    
+        bool            endFade(bool force);
+    
     //Calculate a multiplication coefficient to place the httpdWindow on screen (avoiding overlapping of the windows)
         int             calculate_Coef();
 
@@ -138,6 +168,7 @@ class FLWindow : public QMainWindow
         void            remoteCnxLost(int);
         void            audioError(const QString&);
         void            audioPrefChange();
+        void            updateDone(int ticket, bool success, const QString& errorMsg);
     
     private slots :
         void            edit();
@@ -149,6 +180,12 @@ class FLWindow : public QMainWindow
         void            view_svg();
         void            export_file();
         void            redirectSwitch();
+        void            redirectSwitchDone(int ticket, bool success);
+    
+        void            factoryCompiled(int ticket, const QString& shaKey, void* factory, const QString& compilationError);
+        void            checkFade();
+    
+        void            updateDSPLoad();
     
     public:
     
@@ -172,6 +209,11 @@ class FLWindow : public QMainWindow
     //Called when the X button of a window is triggered
         virtual void    closeEvent(QCloseEvent* event);
     
+    //Visibility changes throttle the refresh of the interfaces
+        virtual void    changeEvent(QEvent* event);
+        virtual void    showEvent(QShowEvent* event);
+        virtual void    hideEvent(QHideEvent* event);
+    
     //-- 4 steps in a interface's life
         bool            allocateInterfaces(const QString& nameEffect); 
         void            buildInterfaces(dsp* dsp);
@@ -184,7 +226,8 @@ class FLWindow : public QMainWindow
     //@param : init = if the window created is a default window.
     //@param : source = DSP to be compiled in the window
     //@param : error = in case init fails, the error is filled
-        bool            init_Window(int init, const QString& source, QString& errorMsg);
+    //@param : factorySetts = factory already compiled for source, if any
+        bool            init_Window(int init, const QString& source, QString& errorMsg, QPair<QString, void*> factorySetts = QPair<QString, void*>());
     
     //If the audio Architecture is modified during execution, the windows have to be updated. 
     //If the change couldn't be done it returns false and the error buffer is filled
@@ -278,8 +321,10 @@ class FLWindow : public QMainWindow
         static          int remoteDSPCallback(int error_code, void* arg);
     
     //Udpate the effect running in the window and all its related parameters.
+    //The update is over when updateDone is emitted with the returned ticket. A newer update supersedes it : it is never emitted then
     //@param : source = DSP that reemplaces the current one
-        bool            update_Window(const QString& source);
+    //@param : keepWavSource = the source is regenerated from the same waveform file
+        int             update_Window(const QString& source, bool keepWavSource = false);
         void            selfUpdate();
         void            selfNameUpdate(const QString& oldSource, const QString& newSource);
               
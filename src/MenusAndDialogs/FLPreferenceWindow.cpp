@@ -7,6 +7,7 @@
 
 #include "FLPreferenceWindow.h"
 #include "FLSettings.h"
+#include "FLOscServer.h"
 
 #include "utilities.h"
 #include <sstream>
@@ -83,12 +84,18 @@ void FLPreferenceWindow::init()
     
     fCompilModes = new QLineEdit(compilationTab);
     fOptVal = new QLineEdit(compilationTab);
+    fMachineCode = new QCheckBox;
+    fMachineCode->setToolTip(tr("The native code of the compiled DSP is saved in the session, the next compilation of the same DSP loads it instead of generating it again"));
+    fInterpreterFirst = new QCheckBox;
+    fInterpreterFirst->setToolTip(tr("An updated DSP is played by the interpreter as soon as possible, then replaced by its LLVM version once compiled"));
     
     //    recall_Settings(fSettingsFolder);
     
     compilationLayout->addRow(new QLabel(tr("")));
     compilationLayout->addRow(new QLabel(tr("Faust Compiler Options")), fCompilModes);
     compilationLayout->addRow(new QLabel(tr("LLVM Optimization")), fOptVal);
+    compilationLayout->addRow(new QLabel(tr("Save Native Code")), fMachineCode);
+    compilationLayout->addRow(new QLabel(tr("Interpreter While Compiling")), fInterpreterFirst);
     compilationLayout->addRow(new QLabel(tr("")));
     
     compilationTab->setLayout(compilationLayout);
@@ -114,12 +121,28 @@ void FLPreferenceWindow::init()
 
     networkLayout->addRow(new QLabel(tr("")));
     networkLayout->addRow(new QLabel(tr("Enable HTTP Interface Automatically")), fHttpAuto);
+    
+    fHttpSinglePort = new QCheckBox;
+    fHttpSinglePort->setToolTip(tr("The HTTP interfaces of the windows are served on the dropping port (at the next launch)"));
+    networkLayout->addRow(new QLabel(tr("HTTP Interfaces On Dropping Port")), fHttpSinglePort);
 
     fOscAuto = new QCheckBox;
 
     networkLayout->addRow(new QLabel(tr("")));
     networkLayout->addRow(new QLabel(tr("Enable OSC Interface Automatically")), fOscAuto);
     
+    fOscBundles = new QCheckBox;
+    fOscBundles->setToolTip(tr("The changes of the zones are sent as one OSC bundle per destination and refresh (for the OSC interfaces enabled afterwards)"));
+    networkLayout->addRow(new QLabel(tr("Send OSC As Bundles")), fOscBundles);
+    
+    fOscShared = new QCheckBox;
+    fOscShared->setToolTip(tr("All the windows receive their OSC messages on one port, addressed as /<window>/... (for the OSC interfaces enabled afterwards)"));
+    networkLayout->addRow(new QLabel(tr("OSC Interfaces On One Port")), fOscShared);
+    
+    fOscPortLine = new QLineEdit(networkTab);
+    fOscPortLine->setToolTip(tr("Port receiving the OSC messages of all the windows (when the OSC server is started)"));
+    networkLayout->addRow(new QLabel(tr("Shared OSC Port")), fOscPortLine);
+    
     fMIDIAuto = new QCheckBox;
     
     networkLayout->addRow(new QLabel(tr("")));
@@ -231,6 +254,8 @@ void FLPreferenceWindow::save()
     }
     
     settings->setValue("General/Compilation/FaustOptions", fCompilModes->text());
+    settings->setValue("General/Compilation/MachineCodeCache", fMachineCode->isChecked());
+    settings->setValue("General/Compilation/InterpreterFirst", fInterpreterFirst->isChecked());
 #ifdef REMOTE
     int portVal;
     
@@ -260,7 +285,15 @@ void FLPreferenceWindow::save()
     }
     
     settings->setValue("General/Network/HttpDefaultChecked", fHttpAuto->isChecked());
+    settings->setValue("General/Network/HttpSinglePort", fHttpSinglePort->isChecked());
     settings->setValue("General/Network/OscDefaultChecked", fOscAuto->isChecked());
+    settings->setValue("General/Network/OscBundles", fOscBundles->isChecked());
+    settings->setValue("General/Network/OscShared", fOscShared->isChecked());
+    
+    if (isStringInt(fOscPortLine->text().toLatin1().data())) {
+        settings->setValue("General/Network/OscPort", atoi(fOscPortLine->text().toLatin1().data()));
+    }
+    
     settings->setValue("General/Control/MIDIDefaultChecked", fMIDIAuto->isChecked());
     settings->setValue("General/Control/PolyphonyDefaultChecked", fPolyAuto->isChecked());
     hide();
@@ -270,6 +303,8 @@ void FLPreferenceWindow::resetVisualObjects()
 {
     fCompilModes->setText(FLSettings::_Instance()->value("General/Compilation/FaustOptions", "").toString());
     fOptVal->setText(QString::number(FLSettings::_Instance()->value("General/Compilation/OptValue", -1).toInt()));
+    fMachineCode->setChecked(FLSettings::_Instance()->value("General/Compilation/MachineCodeCache", false).toBool());
+    fInterpreterFirst->setChecked(FLSettings::_Instance()->value("General/Compilation/InterpreterFirst", false).toBool());
     fServerLine->setText(FLSettings::_Instance()->value("General/Network/FaustWebUrl", "http://faustservice.grame.fr").toString());
     
 #ifdef REMOTE
@@ -278,7 +313,11 @@ void FLPreferenceWindow::resetVisualObjects()
  
     fPortLine->setText(QString::number(FLSettings::_Instance()->value("General/Network/HttpDropPort", 7777).toInt()));
     fHttpAuto->setChecked(FLSettings::_Instance()->value("General/Network/HttpDefaultChecked", false).toBool());
+    fHttpSinglePort->setChecked(FLSettings::_Instance()->value("General/Network/HttpSinglePort", false).toBool());
     fOscAuto->setChecked(FLSettings::_Instance()->value("General/Network/OscDefaultChecked", false).toBool());
+    fOscBundles->setChecked(FLSettings::_Instance()->value("General/Network/OscBundles", false).toBool());
+    fOscShared->setChecked(FLSettings::_Instance()->value("General/Network/OscShared", false).toBool());
+    fOscPortLine->setText(QString::number(FLSettings::_Instance()->value("General/Network/OscPort", kDefaultOscPort).toInt()));
     fMIDIAuto->setChecked(FLSettings::_Instance()->value("General/Control/MIDIDefaultChecked", false).toBool());
     fPolyAuto->setChecked(FLSettings::_Instance()->value("General/Control/PolyphonyDefaultChecked", false).toBool());
 }
@@ -25,11 +25,17 @@ class FLPreferenceWindow : public QDialog
         
         QLineEdit*          fCompilModes;
         QLineEdit*          fOptVal;
+        QCheckBox*          fMachineCode;
+        QCheckBox*          fInterpreterFirst;
         QLineEdit*          fServerLine;
         QLineEdit*          fRemoteServerLine;
         QLineEdit*          fPortLine;
         QCheckBox*          fHttpAuto;
+        QCheckBox*          fHttpSinglePort;
         QCheckBox*          fOscAuto;
+        QCheckBox*          fOscBundles;
+        QCheckBox*          fOscShared;
+        QLineEdit*          fOscPortLine;
         QCheckBox*          fMIDIAuto;
         QCheckBox*          fPolyAuto;
         
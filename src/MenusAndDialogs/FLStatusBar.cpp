@@ -22,11 +22,18 @@ FLStatusBar::FLStatusBar(QSettings* settings, QWidget* parent) : QStatusBar(pare
 
 FLStatusBar::~FLStatusBar()
 {
+#ifdef REMOTE
     setRemoteSettings("local processing", "127.0.0.1", 7777, "dummy");
+#endif
 }
 
 void FLStatusBar::init()
 {
+    fLoadLabel = new QLabel(this);
+    fLoadLabel->setToolTip(tr("DSP load in % of the audio period : mean and peak over the last second, xruns and periods that took longer than their duration"));
+    addWidget(fLoadLabel);
+    clearDSPLoad();
+    
 #ifdef REMOTE
     fRemoteEnabled = false;
     fRemoteButton = new QPushButton();
@@ -84,13 +91,33 @@ void FLStatusBar::openMachineMenu()
 
 void FLStatusBar::setRemoteSettings(const QString& name, const QString& ipServer, int portServer, const QString& target)
 {
+#ifdef REMOTE
     fRemoteButton->setText(name);
+#endif
     fSettings->setValue("RemoteProcessing/MachineName", name);
     fSettings->setValue("RemoteProcessing/MachineIP", ipServer);
     fSettings->setValue("RemoteProcessing/MachinePort", portServer);
     fSettings->setValue("RemoteProcessing/MachineTarget", target);
 }
 
+void FLStatusBar::setDSPLoad(float average, float peak, int xruns, int overBudget)
+{
+    QString text = "DSP " + QString::number(average, 'f', 1) + "% (peak " + QString::number(peak, 'f', 1) + "%)";
+    
+    if (xruns > 0 || overBudget > 0) {
+        text += "  xruns " + QString::number(xruns) + "  over budget " + QString::number(overBudget);
+    }
+    
+    fLoadLabel->setText(text);
+    fLoadLabel->setStyleSheet((peak >= 100) ? "*{color: red;}" : "");
+}
+
+void FLStatusBar::clearDSPLoad()
+{
+    fLoadLabel->setText("DSP -");
+    fLoadLabel->setStyleSheet("");
+}
+
 //Reaction to a click cancellation
 void FLStatusBar::remoteFailed()
 {
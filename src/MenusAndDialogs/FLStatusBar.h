@@ -6,7 +6,7 @@
 //  Copyright (c) 2013 __MyCompanyName__. All rights reserved.
 //
 
-// Status bar of the FLWindows. It contains the feature of remote processing (or the ability to send code to be processed on another machine)
+// Status bar of the FLWindows. It displays the DSP load of the window and contains the feature of remote processing (or the ability to send code to be processed on another machine)
 
 #ifndef _FLStatusBar_h
 #define _FLStatusBar_h
@@ -42,6 +42,8 @@ class FLStatusBar : public QStatusBar{
         QString             fFormerName;
         QString             fFormerTarget;
     
+        QLabel*             fLoadLabel;
+    
         void                init();
     
     public:
@@ -53,6 +55,10 @@ class FLStatusBar : public QStatusBar{
     
         void        remoteFailed();
         void        setRemoteSettings(const QString& name, const QString& ipServer, int portServer, const QString& target);
+    
+    //Load in % of the audio period
+        void        setDSPLoad(float average, float peak, int xruns, int overBudget);
+        void        clearDSPLoad();
      
     public slots: 
     
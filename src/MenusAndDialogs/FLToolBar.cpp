@@ -9,6 +9,7 @@
 #include "FLToolBar.h"
 #include "FLSettings.h"
 #include "utilities.h"
+#include "AudioFader_Implementation.h"
 
 //--------------------------FLToolBar
 
@@ -157,6 +158,30 @@ void FLToolBar::init()
     polyBox->setLayout(polyLayout);
     fContainer->addItem(polyBox, "Polyphony support");
     
+    //------- Crossfade between the old and the new DSP
+    QWidget* fadeBox = new QWidget;
+    QFormLayout* fadeLayout = new QFormLayout;
+    
+    fFadeDurationLine = new QLineEdit(tr(""), fadeBox);
+    fFadeDurationLine->setStyleSheet("*{background-color:white;}");
+    fFadeDurationLine->setMaxLength(5);
+    fFadeDurationLine->setMaximumWidth(50);
+    connect(fFadeDurationLine, SIGNAL(textEdited(const QString&)), this, SLOT(enableButton(const QString&)));
+    connect(fFadeDurationLine, SIGNAL(returnPressed()), this, SLOT(modifiedOptions()));
+    
+    //Items are ordered like the FadeCurve enum
+    fFadeCurveBox = new QComboBox(fadeBox);
+    fFadeCurveBox->addItem(tr("Linear"));
+    fFadeCurveBox->addItem(tr("Equal Power"));
+    fFadeCurveBox->addItem(tr("S-Curve"));
+    connect(fFadeCurveBox, SIGNAL(activated(int)), this, SLOT(enableButton(int)));
+    
+    fadeLayout->addRow(new QLabel(tr("Duration (ms)")), fFadeDurationLine);
+    fadeLayout->addRow(new QLabel(tr("Curve")), fFadeCurveBox);
+    
+    fadeBox->setLayout(fadeLayout);
+    fContainer->addItem(fadeBox, "Crossfade");
+    
  
 #ifdef REMOTE
 //-------- Remote Control
@@ -340,6 +365,9 @@ FLToolBar::~FLToolBar()
     delete fPolyCheckBox;
     delete fPolyGroupCheckBox;
     delete fPolyLine;
+    
+    delete fFadeDurationLine;
+    delete fFadeCurveBox;
 
     delete fOSCCheckBox;
     delete fPortInOscLine;
@@ -380,6 +408,7 @@ bool FLToolBar::hasStateChanged()
         wasHttpSwitched() ||
         wasMIDISwitched() ||
         wasPolyphonySwitched() ||
+        hasFadeOptionsChanged() ||
         wasRemoteControlSwitched() ||
         hasRemoteOptionsChanged() ||
         hasReleaseOptionsChanged());    
@@ -459,6 +488,17 @@ bool FLToolBar::wasPolyphonySwitched()
             || (fPolyLine->text() != fSettings->value("Polyphony/Voice", "4").toString()));
 }
 
+bool FLToolBar::hasFadeOptionsChanged()
+{
+    FLSettings* generalSettings = FLSettings::_Instance();
+    
+    bool ok;
+    int duration = fFadeDurationLine->text().toInt(&ok);
+    
+    return ((ok && duration != fSettings->value("Fade/Duration", generalSettings->value("General/Audio/FadeDuration", kDefaultFadeDuration)).toInt())
+            || fFadeCurveBox->currentIndex() != fSettings->value("Fade/Curve", generalSettings->value("General/Audio/FadeCurve", kLinearFade)).toInt());
+}
+
 bool FLToolBar::wasRemoteControlSwitched()
 {
 //#ifdef REMOTE  
@@ -572,6 +612,17 @@ void FLToolBar::modifiedOptions()
         fSettings->setValue("Polyphony/Voice", fPolyLine->text());
         polyOpt = true;
     }
+    
+    //The crossfade parameters are read at the next update of the window, no signal is needed
+    if (hasFadeOptionsChanged()) {
+        bool ok;
+        int duration = fFadeDurationLine->text().toInt(&ok);
+        
+        if (ok) {
+            fSettings->setValue("Fade/Duration", qBound(kMinFadeDuration, duration, kMaxFadeDuration));
+        }
+        fSettings->setValue("Fade/Curve", fFadeCurveBox->currentIndex());
+    }
  
 #ifdef REMOTE
 //    if(wasRemoteControlSwitched()){
@@ -684,6 +735,10 @@ void FLToolBar::syncVisualParams()
     fPolyCheckBox->setChecked(fSettings->value("Polyphony/Enabled", generalSettings->value("General/Control/PolyphonyDefaultChecked", false)).toBool());
     fPolyGroupCheckBox->setChecked(fSettings->value("Polyphony/GroupEnabled", generalSettings->value("General/Control/PolyphonyGroupDefaultChecked", true)).toBool());
     fPolyLine->setText(fSettings->value("Polyphony/Voice", "4").toString());
+    
+    //------ Crossfade
+    fFadeDurationLine->setText(QString::number(fSettings->value("Fade/Duration", generalSettings->value("General/Audio/FadeDuration", kDefaultFadeDuration)).toInt()));
+    fFadeCurveBox->setCurrentIndex(fSettings->value("Fade/Curve", generalSettings->value("General/Audio/FadeCurve", kLinearFade)).toInt());
 
 #ifdef REMOTE
     //------ RemoteProcessing
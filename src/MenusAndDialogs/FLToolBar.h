@@ -56,6 +56,9 @@ class FLToolBar : public QToolBar{
         QLineEdit*          fPortOutOscLine;    //Edit osc port
         QLineEdit*          fPortErrOscLine;
     
+        QLineEdit*          fFadeDurationLine;  //Crossfade length in ms
+        QComboBox*          fFadeCurveBox;      //Crossfade shape
+    
 //        QCheckBox*          fRemoteControlCheckBox;
 //        QLabel*             fRemoteControlIP;
     
@@ -83,6 +86,7 @@ class FLToolBar : public QToolBar{
         bool                wasHttpSwitched();
         bool                wasMIDISwitched();
         bool                wasPolyphonySwitched();
+        bool                hasFadeOptionsChanged();
         bool                wasRemoteControlSwitched();
         bool                hasRemoteOptionsChanged();
         bool                hasReleaseOptionsChanged();;
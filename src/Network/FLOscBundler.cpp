@@ -0,0 +1,263 @@
+//
+//  FLOscBundler.cpp
+//
+//  This file is part of FaustLive, released under the GNU General Public License version 3 (see GPL.txt).
+//
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+
+#include <QTimer>
+#include <QUdpSocket>
+#include <QHostInfo>
+
+#include "FLOscBundler.h"
+#include "FLSettings.h"
+#include "faust/gui/APIUI.h"
+
+using namespace std;
+
+FLOscBundler* FLOscBundler::_bundlerInstance = NULL;
+
+//----------------------CONSTRUCTOR/DESTRUCTOR---------------------------
+
+FLOscBundler::FLOscBundler()
+{
+    fSocket = new QUdpSocket(this);
+    fTimer = new QTimer(this);
+    connect(fTimer, SIGNAL(timeout()), this, SLOT(sendChanges()));
+
+    fCredit = 0;
+    fFirstDestination = 0;
+    readSettings();
+}
+
+FLOscBundler::~FLOscBundler()
+{}
+
+FLOscBundler* FLOscBundler::_Instance()
+{
+    if (_bundlerInstance == NULL) {
+        FLOscBundler::_bundlerInstance = new FLOscBundler;
+    }
+
+    return FLOscBundler::_bundlerInstance;
+}
+
+void FLOscBundler::deleteInstance()
+{
+    delete FLOscBundler::_bundlerInstance;
+    FLOscBundler::_bundlerInstance = NULL;
+}
+
+bool FLOscBundler::isEnabled()
+{
+    return FLSettings::_Instance()->value("General/Network/OscBundles", false).toBool();
+}
+
+void FLOscBundler::readSettings()
+{
+    fTimer->setInterval(qMax(1, FLSettings::_Instance()->value("General/Network/OscSendRate", kDefaultOscSendRate).toInt()));
+    fThreshold = qMax(0.0, FLSettings::_Instance()->value("General/Network/OscThreshold", 0).toDouble() / 100.0);
+    fMaxPackets = qMax(1, FLSettings::_Instance()->value("General/Network/OscMaxPackets", kDefaultOscMaxPackets).toInt());
+}
+
+//----------------------REGISTRATION---------------------------
+
+//The destination is resolved once by host name, without blocking the GUI thread
+void FLOscBundler::registerZones(APIUI* zones, const void* owner, const string& host, int port, const string& prefix)
+{
+    oscTarget target;
+    target.fZones = zones;
+    target.fHostName = host;
+    target.fPort = port;
+    target.fPrefix = prefix;
+
+    if (host == "localhost") {
+        target.fHost = QHostAddress(QHostAddress::LocalHost);
+    } else if (fResolvedHosts.count(host)) {
+        target.fHost = fResolvedHosts[host];
+    } else if (!target.fHost.setAddress(QString::fromStdString(host)) && fPendingHosts.insert(host).second) {
+        QHostInfo::lookupHost(QString::fromStdString(host), this, SLOT(hostResolved(const QHostInfo&)));
+    }
+
+    fTargets[owner] = target;
+
+    readSettings();
+    if (!fTimer->isActive()) {
+        fCredit = 0;
+        fLastTick.start();
+        fTimer->start();
+    }
+}
+
+void FLOscBundler::unregisterZones(const void* owner)
+{
+    fTargets.erase(owner);
+
+    if (fTargets.empty()) {
+        fTimer->stop();
+    }
+}
+
+//The targets registered meanwhile get the address
+void FLOscBundler::hostResolved(const QHostInfo& info)
+{
+    string host = info.hostName().toStdString();
+    fPendingHosts.erase(host);
+
+    if (info.addresses().isEmpty()) {
+        printf("FLOscBundler : unknown host %s\n", host.c_str());
+        return;
+    }
+
+    fResolvedHosts[host] = info.addresses().first();
+
+    for (map<const void*, oscTarget>::iterator it = fTargets.begin(); it != fTargets.end(); it++) {
+        if (it->second.fHostName == host) {
+            it->second.fHost = fResolvedHosts[host];
+        }
+    }
+}
+
+//----------------------SENDING---------------------------
+
+//The zones never sent are sent whatever their value
+void FLOscBundler::collectChanges(oscTarget& target, vector<oscChange>& changes)
+{
+    int count = target.fZones->getParamsCount();
+
+    if ((int)target.fSent.size() != count) {
+        target.fSent.assign(count, NAN);
+    }
+
+    for (int i = 0; i < count; i++) {
+
+        double value = target.fZones->getParamValue(i);
+        double sent = target.fSent[i];
+        double range = fabs(double(target.fZones->getParamMax(i)) - double(target.fZones->getParamMin(i)));
+
+        if (std::isnan(sent) || (value != sent && fabs(value - sent) >= fThreshold * range)) {
+            oscChange change;
+            change.fTarget = &target;
+            change.fIndex = i;
+            change.fValue = value;
+            changes.push_back(change);
+        }
+    }
+}
+
+void FLOscBundler::sendChanges()
+{
+    // Credit earned since the previous tick, up to two ticks worth of packets
+    double maxCredit = qMax(1.0, 2.0 * fMaxPackets * fTimer->interval() / 1000.0);
+    fCredit = qMin(maxCredit, fCredit + fMaxPackets * fLastTick.restart() / 1000.0);
+
+    if (fCredit < 1) {
+        return;
+    }
+
+    // All the windows sending to the same destination share their bundles
+    map<pair<QString, quint16>, vector<oscChange> > destinations;
+
+    for (map<const void*, oscTarget>::iterator it = fTargets.begin(); it != fTargets.end(); it++) {
+        if (!it->second.fHost.isNull()) {
+            collectChanges(it->second, destinations[make_pair(it->second.fHost.toString(), it->second.fPort)]);
+        }
+    }
+
+    int count = destinations.size();
+
+    if (count == 0) {
+        return;
+    }
+
+    fFirstDestination = (fFirstDestination + 1) % count;
+
+    map<pair<QString, quint16>, vector<oscChange> >::iterator it = destinations.begin();
+    std::advance(it, fFirstDestination);
+
+    for (int i = 0; i < count && fCredit >= 1; i++) {
+
+        if (!it->second.empty()) {
+            fCredit -= sendBundles(QHostAddress(it->first.first), it->first.second, it->second);
+        }
+
+        if (++it == destinations.end()) {
+            it = destinations.begin();
+        }
+    }
+}
+
+//Packs the changes in as many bundles as needed and sends them while there is credit left. Returns the number of bundles sent
+int FLOscBundler::sendBundles(const QHostAddress& host, quint16 port, vector<oscChange>& changes)
+{
+    QByteArray header;
+    appendString(header, "#bundle");
+    appendInt(header, 0);   // Time tag 1 : immediately
+    appendInt(header, 1);
+
+    int sent = 0;
+    size_t first = 0;
+    QByteArray bundle = header;
+
+    for (size_t i = 0; i <= changes.size(); i++) {
+
+        QByteArray message;
+
+        if (i < changes.size()) {
+            oscChange& change = changes[i];
+            float value = float(change.fValue);
+            quint32 bits;
+            memcpy(&bits, &value, sizeof(bits));
+
+            appendString(message, change.fTarget->fPrefix + change.fTarget->fZones->getParamAddress(change.fIndex));
+            appendString(message, ",f");
+            appendInt(message, bits);
+        }
+
+        // The bundle is full or there is nothing left to pack
+        if (i > first && (i == changes.size() || bundle.size() + 4 + message.size() > kMaxOscPacket)) {
+
+            if (fCredit - sent < 1) {
+                break;
+            }
+
+            fSocket->writeDatagram(bundle, host, port);
+            sent++;
+
+            for (size_t j = first; j < i; j++) {
+                changes[j].fTarget->fSent[changes[j].fIndex] = changes[j].fValue;
+            }
+
+            first = i;
+            bundle = header;
+        }
+
+        if (i < changes.size()) {
+            appendInt(bundle, message.size());
+            bundle.append(message);
+        }
+    }
+
+    return sent;
+}
+
+//OSC strings are null terminated and padded to 4 bytes
+void FLOscBundler::appendString(QByteArray& packet, const string& str)
+{
+    packet.append(str.c_str(), str.size());
+    packet.append(QByteArray(4 - (str.size() % 4), '\0'));
+}
+
+void FLOscBundler::appendInt(QByteArray& packet, quint32 value)
+{
+    char bytes[4];
+    bytes[0] = (value >> 24) & 0xFF;
+    bytes[1] = (value >> 16) & 0xFF;
+    bytes[2] = (value >> 8) & 0xFF;
+    bytes[3] = value & 0xFF;
+    packet.append(bytes, 4);
+}
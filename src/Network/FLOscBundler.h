@@ -0,0 +1,107 @@
+//
+//  FLOscBundler.h
+//
+//  This file is part of FaustLive, released under the GNU General Public License version 3 (see GPL.txt).
+//
+
+// In bundle mode (General/Network/OscBundles), the OSC interfaces of the windows do not transmit their zones one message at a time anymore.
+// At each tick (General/Network/OscSendRate ms), FLOscBundler packs the zones that moved by more than General/Network/OscThreshold
+// (in % of their range) into one bundle per destination : the windows sending to the same host and port share their bundles.
+//
+// The number of packets sent by second, all windows included, is limited by General/Network/OscMaxPackets.
+// The changes that could not be sent are sent at a next tick, with the values they have by then.
+//
+// The windows register their zones from the GUI thread, where the bundles are sent too.
+// The host names are resolved in the background and kept : nothing is sent to a destination until its address is known.
+
+#ifndef _FLOscBundler_h
+#define _FLOscBundler_h
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHostAddress>
+
+#define kDefaultOscSendRate     40      // ms
+#define kDefaultOscMaxPackets   500     // by second
+#define kMaxOscPacket           1400    // bytes : a bundle fits in an ethernet frame
+
+class APIUI;
+class QHostInfo;
+class QTimer;
+class QUdpSocket;
+
+class FLOscBundler : public QObject
+{
+    private:
+
+        Q_OBJECT
+
+        // Zones of a window and values last sent
+        struct oscTarget {
+            APIUI*              fZones;
+            std::string         fHostName;
+            QHostAddress        fHost;      // Null until the host name is resolved
+            quint16             fPort;
+            std::string         fPrefix;    // Prepended to the addresses of the zones
+            std::vector<double> fSent;
+
+            oscTarget() : fZones(NULL), fPort(0) {}
+        };
+
+        // A zone to send in the current tick
+        struct oscChange {
+            oscTarget*  fTarget;
+            int         fIndex;
+            double      fValue;
+        };
+
+        std::map<const void*, oscTarget> fTargets;
+    
+        std::map<std::string, QHostAddress> fResolvedHosts;
+        std::set<std::string>               fPendingHosts;
+
+        QUdpSocket*     fSocket;
+        QTimer*         fTimer;
+
+        double          fThreshold;     // Fraction of the range of a zone
+        int             fMaxPackets;
+        double          fCredit;        // Packets that can be sent now
+        QElapsedTimer   fLastTick;
+        int             fFirstDestination;  // The destinations take turns when the packets are limited
+
+        static FLOscBundler* _bundlerInstance;
+
+        void            readSettings();
+        void            collectChanges(oscTarget& target, std::vector<oscChange>& changes);
+        int             sendBundles(const QHostAddress& host, quint16 port, std::vector<oscChange>& changes);
+
+        static void     appendString(QByteArray& packet, const std::string& str);
+        static void     appendInt(QByteArray& packet, quint32 value);
+
+    private slots:
+
+        void            sendChanges();
+        void            hostResolved(const QHostInfo& info);
+
+    public:
+
+        FLOscBundler();
+        virtual ~FLOscBundler();
+
+        static FLOscBundler* _Instance();
+        static void     deleteInstance();
+
+        static bool     isEnabled();
+
+        //The zones have to be unregistered before they are deleted
+        void            registerZones(APIUI* zones, const void* owner, const std::string& host, int port, const std::string& prefix = "");
+        void            unregisterZones(const void* owner);
+};
+
+#endif
@@ -0,0 +1,299 @@
+//
+//  FLOscServer.cpp
+//
+//  This file is part of FaustLive, released under the GNU General Public License version 3 (see GPL.txt).
+//
+
+#include <cstdio>
+#include <cstring>
+
+#include <QUdpSocket>
+
+#include "FLOscServer.h"
+#include "FLSettings.h"
+#include "faust/gui/APIUI.h"
+
+using namespace std;
+
+FLOscServer* FLOscServer::_oscServerInstance = NULL;
+
+//----------------------CONSTRUCTOR/DESTRUCTOR---------------------------
+
+FLOscServer::FLOscServer()
+{
+    fPort = kDefaultOscPort;
+    fRunning = false;
+    fListening = false;
+    fTrie.resize(1);
+}
+
+FLOscServer::~FLOscServer()
+{
+    fRunning = false;
+    wait();
+}
+
+FLOscServer* FLOscServer::_Instance()
+{
+    if (_oscServerInstance == NULL) {
+        FLOscServer::_oscServerInstance = new FLOscServer;
+    }
+
+    return FLOscServer::_oscServerInstance;
+}
+
+void FLOscServer::deleteInstance()
+{
+    delete FLOscServer::_oscServerInstance;
+    FLOscServer::_oscServerInstance = NULL;
+}
+
+bool FLOscServer::isEnabled()
+{
+    return FLSettings::_Instance()->value("General/Network/OscShared", false).toBool();
+}
+
+//----------------------REGISTRATION---------------------------
+
+bool FLOscServer::registerZones(const string& window, APIUI* zones)
+{
+    // The thread is started with the first window and reports whether it could bind its socket
+    if (!isRunning()) {
+        fPort = FLSettings::_Instance()->value("General/Network/OscPort", kDefaultOscPort).toInt();
+        fRunning = true;
+        start();
+        fStarted.acquire();
+
+        if (!fListening) {
+            wait();
+            return false;
+        }
+    }
+
+    fWindows[window] = zones;
+    buildTrie();
+    return true;
+}
+
+void FLOscServer::unregisterZones(const string& window)
+{
+    if (fWindows.erase(window) > 0) {
+        buildTrie();
+    }
+}
+
+//The new trie is built aside : the listening thread only waits for the swap
+void FLOscServer::buildTrie()
+{
+    vector<oscNode> trie(1);
+
+    for (map<string, APIUI*>::iterator it = fWindows.begin(); it != fWindows.end(); it++) {
+
+        APIUI* zones = it->second;
+
+        for (int i = 0; i < zones->getParamsCount(); i++) {
+
+            string address = "/" + it->first + zones->getParamAddress(i);
+            int node = 0;
+            size_t begin = 1;
+
+            while (begin <= address.size()) {
+
+                size_t end = address.find('/', begin);
+                if (end == string::npos) {
+                    end = address.size();
+                }
+
+                if (end > begin) {
+                    string segment = address.substr(begin, end - begin);
+                    int child = findChild(trie, node, segment.c_str(), segment.size());
+
+                    if (child < 0) {
+                        child = trie.size();
+                        trie.push_back(oscNode());
+
+                        vector<pair<string, int> >& children = trie[node].fChildren;
+                        vector<pair<string, int> >::iterator pos = children.begin();
+                        while (pos != children.end() && pos->first < segment) {
+                            pos++;
+                        }
+                        children.insert(pos, make_pair(segment, child));
+                    }
+                    node = child;
+                }
+
+                begin = end + 1;
+            }
+
+            trie[node].fZones = zones;
+            trie[node].fIndex = i;
+        }
+    }
+
+    fZonesMutex.lock();
+    fTrie.swap(trie);
+    fZonesMutex.unlock();
+}
+
+//Binary search among the children of the node
+int FLOscServer::findChild(const vector<oscNode>& trie, int node, const char* segment, size_t length)
+{
+    const vector<pair<string, int> >& children = trie[node].fChildren;
+    int low = 0;
+    int high = int(children.size()) - 1;
+
+    while (low <= high) {
+
+        int middle = (low + high) / 2;
+        int comparison = children[middle].first.compare(0, string::npos, segment, length);
+
+        if (comparison == 0) {
+            return children[middle].second;
+        } else if (comparison < 0) {
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+
+    return -1;
+}
+
+//----------------------LISTENING THREAD---------------------------
+
+void FLOscServer::run()
+{
+    QUdpSocket socket;
+    fListening = socket.bind(QHostAddress::Any, fPort);
+    fStarted.release();
+
+    if (!fListening) {
+        printf("FLOscServer : port %d could not be opened\n", fPort);
+        return;
+    }
+
+    QByteArray datagram;
+
+    while (fRunning) {
+
+        if (!socket.waitForReadyRead(kOscServerTimeOut)) {
+            continue;
+        }
+
+        while (socket.hasPendingDatagrams()) {
+
+            datagram.resize(int(socket.pendingDatagramSize()));
+            qint64 size = socket.readDatagram(datagram.data(), datagram.size());
+
+            if (size > 0) {
+                QMutexLocker locker(&fZonesMutex);
+                dispatchPacket(datagram.constData(), size_t(size));
+            }
+        }
+    }
+}
+
+static quint32 readInt(const char* data)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    return (quint32(bytes[0]) << 24) | (quint32(bytes[1]) << 16) | (quint32(bytes[2]) << 8) | quint32(bytes[3]);
+}
+
+//Size of an OSC string with its padding, 0 if it is not terminated
+static size_t stringSize(const char* data, size_t size)
+{
+    const char* end = (const char*)memchr(data, '\0', size);
+    return (end) ? ((end - data) + 4) & ~size_t(3) : 0;
+}
+
+//The elements of a bundle are dispatched right away, whatever their time tag
+void FLOscServer::dispatchPacket(const char* data, size_t size)
+{
+    if (size >= 16 && memcmp(data, "#bundle", 8) == 0) {
+
+        size_t pos = 16;
+
+        while (pos + 4 <= size) {
+
+            size_t element = readInt(data + pos);
+            pos += 4;
+
+            if (element > size - pos) {
+                break;
+            }
+
+            dispatchPacket(data + pos, element);
+            pos += element;
+        }
+    } else {
+        dispatchMessage(data, size);
+    }
+}
+
+//The zone takes the first argument of the message. The messages without argument are ignored
+void FLOscServer::dispatchMessage(const char* data, size_t size)
+{
+    size_t addressSize = stringSize(data, size);
+
+    if (addressSize == 0 || addressSize >= size || data[0] != '/') {
+        return;
+    }
+
+    const char* tags = data + addressSize;
+    size_t tagsSize = stringSize(tags, size - addressSize);
+
+    if (tagsSize == 0 || tagsSize > size - addressSize || tags[0] != ',') {
+        return;
+    }
+
+    const char* argument = tags + tagsSize;
+    size_t argumentSize = size - addressSize - tagsSize;
+    double value;
+
+    if (tags[1] == 'f' && argumentSize >= 4) {
+        quint32 bits = readInt(argument);
+        float f;
+        memcpy(&f, &bits, sizeof(f));
+        value = f;
+    } else if (tags[1] == 'i' && argumentSize >= 4) {
+        value = qint32(readInt(argument));
+    } else if (tags[1] == 'd' && argumentSize >= 8) {
+        quint64 bits = (quint64(readInt(argument)) << 32) | readInt(argument + 4);
+        double d;
+        memcpy(&d, &bits, sizeof(d));
+        value = d;
+    } else if (tags[1] == 'h' && argumentSize >= 8) {
+        value = double(qint64((quint64(readInt(argument)) << 32) | readInt(argument + 4)));
+    } else {
+        return;
+    }
+
+    // Walks down the trie, one segment of the address at a time
+    const char* address = data;
+    size_t length = strlen(address);
+    size_t begin = 1;
+    int node = 0;
+
+    while (begin < length) {
+
+        const char* end = (const char*)memchr(address + begin, '/', length - begin);
+        size_t segment = (end) ? (end - address) - begin : length - begin;
+
+        if (segment > 0) {
+            node = findChild(fTrie, node, address + begin, segment);
+            if (node < 0) {
+                return;
+            }
+        }
+
+        begin += segment + 1;
+    }
+
+    APIUI* zones = fTrie[node].fZones;
+
+    if (zones) {
+        int index = fTrie[node].fIndex;
+        value = qMax(double(zones->getParamMin(index)), qMin(double(zones->getParamMax(index)), value));
+        zones->setParamValue(index, FAUSTFLOAT(value));
+    }
+}
@@ -0,0 +1,83 @@
+//
+//  FLOscServer.h
+//
+//  This file is part of FaustLive, released under the GNU General Public License version 3 (see GPL.txt).
+//
+
+// In shared mode (General/Network/OscShared), the windows do not open their own OSC sockets and listening thread anymore.
+// FLOscServer receives the messages of all the windows on one port (General/Network/OscPort), in one thread,
+// and dispatches them by their address : /<window>/<address of the zone in the window>.
+//
+// The addresses are compiled in a trie of their segments, rebuilt when a window registers or unregisters its zones.
+// The windows transmit their zones through FLOscBundler, with the same addresses.
+
+#ifndef _FLOscServer_h
+#define _FLOscServer_h
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <QThread>
+#include <QMutex>
+#include <QSemaphore>
+
+#define kDefaultOscPort     5500    // Below the ports of the OSC interfaces of the windows (Osc/InPort, from 5510)
+#define kOscServerTimeOut   100     // ms : the thread checks regularly whether it has to stop
+
+class APIUI;
+
+class FLOscServer : public QThread
+{
+    private:
+
+        Q_OBJECT
+
+        // A segment of the addresses. The children are sorted by name
+        struct oscNode {
+            std::vector<std::pair<std::string, int> > fChildren;
+            APIUI*  fZones;
+            int     fIndex;     // Of the zone, if the address ends here
+
+            oscNode() : fZones(NULL), fIndex(-1) {}
+        };
+
+        std::map<std::string, APIUI*> fWindows;    // GUI thread only
+
+    //The zones are only written with the mutex locked
+        QMutex                  fZonesMutex;
+        std::vector<oscNode>    fTrie;
+
+        int                     fPort;
+        std::atomic<bool>       fRunning;
+        bool                    fListening;
+        QSemaphore              fStarted;   // The socket was bound, or could not be
+
+        static FLOscServer*     _oscServerInstance;
+
+        void                    buildTrie();
+        static int              findChild(const std::vector<oscNode>& trie, int node, const char* segment, size_t length);
+
+        void                    dispatchPacket(const char* data, size_t size);
+        void                    dispatchMessage(const char* data, size_t size);
+
+        virtual void            run();
+
+    public:
+
+        FLOscServer();
+        virtual ~FLOscServer();
+
+        static FLOscServer*     _Instance();
+        static void             deleteInstance();
+
+        static bool             isEnabled();
+
+    //The server starts listening with the first window. Once unregisterZones returns, the zones of the window are not used anymore
+        bool                    registerZones(const std::string& window, APIUI* zones);
+        void                    unregisterZones(const std::string& window);
+};
+
+#endif
@@ -12,42 +12,141 @@
 #include <sstream>
 #include <iostream>
 #include <fstream> 
-
-#ifndef WIN32
-#include <curl/curl.h>
-#endif
+#include <cmath>
+#include <stdio.h>
 
 // don't change the next includes order and always keep FLServerHttp.h on first place
 // it (indirectly) solves the conflict between winsock2 and windows
 #include "FLServerHttp.h"
 #include "FLSettings.h"
+#include "FLCompileStats.h"
 #include "utilities.h"
+#include "faust/gui/APIUI.h"
+
+#include <QTimer>
 
 #define kFile       "HtmlCompiler.html"
 #define kTmpFile    "TmpFile.dsp"
 
+// The connections can be suspended during the compilation (MHD_USE_SUSPEND_RESUME is deprecated since 0.9.53)
+#if MHD_VERSION >= 0x00095300
+#define kSuspendFlag MHD_ALLOW_SUSPEND_RESUME
+#else
+#define kSuspendFlag MHD_USE_SUSPEND_RESUME
+#endif
+
+#if MHD_VERSION >= 0x00095300
+#define kEpollFlag MHD_USE_EPOLL_INTERNAL_THREAD
+#else
+#define kEpollFlag MHD_USE_EPOLL_INTERNALLY_LINUX_ONLY
+#endif
+
 using namespace std;
 
+//The window names and the zone addresses come from the DSP sources
+static string jsonString(const string& text)
+{
+    string escaped = "\"";
+    
+    for (size_t i = 0; i < text.size(); i++) {
+        unsigned char c = text[i];
+        
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (c < 0x20) {
+            char code[8];
+            snprintf(code, sizeof(code), "\\u%04x", c);
+            escaped += code;
+        } else {
+            escaped += c;
+        }
+    }
+    
+    return escaped + '"';
+}
+
+//JSON has no NaN nor infinity : such a value (of a bargraph for example) is written as null
+static string jsonNumber(double value)
+{
+    if (!std::isfinite(value)) {
+        return "null";
+    }
+    
+    stringstream number;
+    number << value;
+    return number.str();
+}
+
+//A value that is not finite is not given to a zone
+static bool readValue(const char* value, FAUSTFLOAT& result)
+{
+    double number = atof(value);
+    
+    if (!std::isfinite(number)) {
+        return false;
+    }
+    
+    result = (FAUSTFLOAT)number;
+    return true;
+}
+
 //--------------------------FLINTERMEDIATESERVER--------------------------//
 
 FLServerHttp* FLServerHttp::_serverInstance = NULL;
 
 //--------------------------FLSERVER-------------------------------------//
-int FLServerHttp::fUploadingClients = 0;
+std::atomic<int> FLServerHttp::fUploadingClients(0);
 
 FLServerHttp::FLServerHttp(const string& home)
 {
     fHome = home;
-    fError = "";
-    fUrl = "";
-    fPosted = false;
-    fCompiled = false;
-    fHtml = "";
-    fJson = "";
+    fNextRequest = 0;
     fMaxCients = 20;
+    fClosed = false;
+    
+    // The windows are created accordingly : the mode is changed at the next launch
+    fSinglePort = FLSettings::_Instance()->value("General/Network/HttpSinglePort", false).toBool();
+    
+    fResponseHead = readFile((fHome + "/ServerHead.html").c_str()).toStdString();
+    fResponseTail = readFile((fHome + "/ServerTail.html").c_str()).toStdString();
+    fInterfacesHead = readFile((fHome + "/ServerAvailableInterfacesHead.html").c_str()).toStdString();
+    fInterfacesTail = readFile((fHome + "/ServerAvailableInterfacesTail.html").c_str()).toStdString();
+    
+    fRootPage = fResponseHead + fResponseTail;
+    fRootResponse = createCachedPage(fRootPage, "text/html", true);
+    fWindowPage = readFile((fHome + "/ServerWindowInterface.html").c_str()).toStdString();
+    fWindowResponse = createCachedPage(fWindowPage, "text/html", true);
+    
+    fInterfacesHtml = NULL;
+    fInterfacesJson = NULL;
+    updateAvailableInterfaces();
+    
+    fIdleTime = 0;
+    fPushTimer = new QTimer(this);
+    connect(fPushTimer, SIGNAL(timeout()), this, SLOT(pushChanges()));
 }
 
-FLServerHttp::~FLServerHttp() {}
+FLServerHttp::~FLServerHttp()
+{
+    // The daemon threads may still be answering with the cached pages
+    stop();
+    
+    deleteCachedPage(fRootResponse);
+    deleteCachedPage(fWindowResponse);
+    deleteCachedPage(fInterfacesHtml);
+    deleteCachedPage(fInterfacesJson);
+    
+    for (map<string, cachedPage*>::iterator it = fWrappedPages.begin(); it != fWrappedPages.end(); it++) {
+        deleteCachedPage(it->second);
+    }
+    for (map<int, cachedPage*>::iterator it = fInterfacesJsons.begin(); it != fInterfacesJsons.end(); it++) {
+        deleteCachedPage(it->second);
+    }
+    for (map<string, windowInterface>::iterator it = fWindowInterfaces.begin(); it != fWindowInterfaces.end(); it++) {
+        deleteCachedPage(it->second.fJson);
+    }
+}
 
 void FLServerHttp::createInstance(const string& home)
 {
@@ -69,27 +168,73 @@ FLServerHttp* FLServerHttp::_Instance()
 bool FLServerHttp::start()
 {
     unsigned short port = FLSettings::_Instance()->value("General/Network/HttpDropPort", 7777).toInt();
-    fServerAddress = "http://" + searchLocalIP().toStdString() + ":" + QString::number(port).toStdString() + "/";
+    fLocalAddress = "http://" + searchLocalIP().toStdString() + ":";
+    fServerAddress = fLocalAddress + QString::number(port).toStdString() + "/";
+    fClosed = false;
 
-    fDaemon = MHD_start_daemon(MHD_USE_SELECT_INTERNALLY,
-                               port, 
-                               NULL, 
-                               NULL, 
-                               (MHD_AccessHandlerCallback)answerToConnection,
-                               this, MHD_OPTION_NOTIFY_COMPLETED, 
-                               requestCompleted, NULL, MHD_OPTION_END);
+    // In single port mode, the requests of all the windows are answered by a pool of threads
+    if (fSinglePort) {
+        
+        unsigned int flags = MHD_USE_SELECT_INTERNALLY | kSuspendFlag;
+    #ifdef __linux__
+        flags |= kEpollFlag;
+    #endif
+        unsigned int numThreads = qMax(1, FLSettings::_Instance()->value("General/Network/HttpThreads", kDefaultHttpThreads).toInt());
+        
+        fDaemon = MHD_start_daemon(flags,
+                                   port,
+                                   NULL,
+                                   NULL,
+                                   (MHD_AccessHandlerCallback)answerToConnection,
+                                   this, MHD_OPTION_NOTIFY_COMPLETED,
+                                   requestCompleted, NULL,
+                                   MHD_OPTION_THREAD_POOL_SIZE, numThreads,
+                                   MHD_OPTION_END);
+    } else {
+        fDaemon = MHD_start_daemon(MHD_USE_SELECT_INTERNALLY | kSuspendFlag,
+                                   port, 
+                                   NULL, 
+                                   NULL, 
+                                   (MHD_AccessHandlerCallback)answerToConnection,
+                                   this, MHD_OPTION_NOTIFY_COMPLETED, 
+                                   requestCompleted, NULL, MHD_OPTION_END);
+    }
     
     if (fDaemon) {
         printf("Server started = %p \n", fDaemon);
+        fPushTimer->start(qMax(10, FLSettings::_Instance()->value("General/Network/HttpPushRate", kDefaultHttpPushRate).toInt()));
         return true;
     } else {
         return false;
     }
 }
 
-//Stop Server Listening
+//Stop Server Listening. The suspended connections have to be resumed before : once fClosed is set, the daemon threads do not suspend any more
 void FLServerHttp::stop()
 {
+    fRequestsMutex.lock();
+    fEventsMutex.lock();
+    fClosed = true;
+    fEventsMutex.unlock();
+    map<int, pair<MHD_Connection*, connection_info*> > requests = fSuspendedRequests;
+    fRequestsMutex.unlock();
+    
+    for (map<int, pair<MHD_Connection*, connection_info*> >::iterator it = requests.begin(); it != requests.end(); it++) {
+        compileFailed(it->first, "The server was stopped");
+    }
+    
+    fPushTimer->stop();
+    
+    fEventsMutex.lock();
+    for (list<eventClient*>::iterator it = fEventClients.begin(); it != fEventClients.end(); it++) {
+        (*it)->fClosed = true;
+        if ((*it)->fSuspended) {
+            (*it)->fSuspended = false;
+            MHD_resume_connection((*it)->fConnection);
+        }
+    }
+    fEventsMutex.unlock();
+    
     if (fDaemon) {
         MHD_stop_daemon(fDaemon);
         fDaemon = 0;
@@ -99,20 +244,64 @@ void FLServerHttp::stop()
 //---------------------- HANDLE REQUESTS ------------------------
 int FLServerHttp::handleGet(MHD_Connection* connection, const char* url)
 {
-    stringstream ss;
-    
-    string head = fHome + "/ServerHead.html";
-    string tail = fHome + "/ServerTail.html";
+    // Push channel and batched control of the windows
+    if (strcmp(url, "/events") == 0) {
+        return handleEventsRequest(connection);
+    } else if (strcmp(url, "/control") == 0) {
+        return handleControlRequest(connection);
+    }
     
-    string responseHead = readFile(head.c_str()).toStdString();
-    string responseTail = readFile(tail.c_str()).toStdString();
+    // Control of a window in single port mode
+    if (fSinglePort) {
+        
+        string path(url);
+        size_t end = path.find('/', 1);
+        string window = path.substr(1, (end == string::npos) ? string::npos : end - 1);
+        
+        fWindowsMutex.lock();
+        map<string, windowInterface>::iterator it = fWindowInterfaces.find(window);
+        
+        if (it != fWindowInterfaces.end()) {
+            
+            // The drop zone wraps the HTML interface of the window, the code dropped there is compiled in the window
+            if (end == string::npos) {
+                fPagesMutex.lock();
+                int ret = sendWrappedPage(connection, fServerAddress + window + "/");
+                fPagesMutex.unlock();
+                fWindowsMutex.unlock();
+                return ret;
+            }
+            
+            int ret = handleWindowRequest(connection, it->second, path.substr(end));
+            fWindowsMutex.unlock();
+            return ret;
+        }
+        
+        fWindowsMutex.unlock();
+    }
     
     // Request for the server
     if (strcmp(url,"/availableInterfaces") == 0) {
-        return sendPage(connection, fHtml.c_str (), fHtml.size(), MHD_HTTP_OK, "text/html");
+        QMutexLocker locker(&fPagesMutex);
+        return sendCachedPage(connection, fInterfacesHtml);
     
     } else if (strcmp(url,"/availableInterfaces/JSON") == 0) {
-        return sendPage(connection, fJson.c_str (), fJson.size(), MHD_HTTP_OK, "application/json");
+        QMutexLocker locker(&fPagesMutex);
+        return sendCachedPage(connection, fInterfacesJson);
+    
+    // Duration of the phases of the last compilations
+    } else if (strcmp(url,"/stats/compile") == 0) {
+        string stats = FLCompileStats::_Instance()->toJSON().toStdString();
+        return sendPage(connection, stats.c_str(), stats.size(), MHD_HTTP_OK, "application/json");
+        
+    } else if (strcmp(url,"/stats/compile/CSV") == 0) {
+        string stats = FLCompileStats::_Instance()->toCSV().toStdString();
+        return sendPage(connection, stats.c_str(), stats.size(), MHD_HTTP_OK, "text/csv");
+    
+    // DSP load of the windows
+    } else if (strcmp(url,"/stats/load") == 0) {
+        string loads = getDSPLoads();
+        return sendPage(connection, loads.c_str(), loads.size(), MHD_HTTP_OK, "application/json");
 
     // Request for an interface
     } else if (strcmp(url,"/") != 0 && strcmp(url, "/favicon.ico")) {
@@ -130,36 +319,154 @@ int FLServerHttp::handleGet(MHD_Connection* connection, const char* url)
             string portNumber(url);
             portNumber = portNumber.substr(1, portNumber.size()-1);
             
-            ss << responseHead << "http://"<< searchLocalIP().toStdString().c_str() <<":"<<portNumber.c_str()<< responseTail;
-            return sendPage(connection, ss.str().c_str (), ss.str().size(), MHD_HTTP_OK, "text/html");
+            // Only the declared interfaces are wrapped, the other requests get the root page
+            QMutexLocker locker(&fPagesMutex);
+            if (fInterfacesJsons.count(atoi(portNumber.c_str())) > 0) {
+                return sendWrappedPage(connection, fLocalAddress + portNumber);
+            }
         }
     }
      
-    ss<<responseHead<<responseTail; 
-    return sendPage(connection, ss.str().c_str (), ss.str().size(), MHD_HTTP_OK, "text/html");
+    return sendCachedPage(connection, fRootResponse);
+}
+
+//Same answer as httpdUI : the address of the parameter followed by its value
+int FLServerHttp::handleWindowRequest(MHD_Connection* connection, windowInterface& window, const string& path)
+{
+    if (path == "/") {
+        return sendCachedPage(connection, fWindowResponse);
+    } else if (path == "/JSON") {
+        return sendCachedPage(connection, window.fJson);
+    }
+    
+    int index = window.fZones->getParamIndex(path.c_str());
+    
+    if (index < 0) {
+        return sendPage(connection, kErrorPage, strlen(kErrorPage), MHD_HTTP_NOT_FOUND, "text/html", true);
+    }
+    
+    const char* value = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "value");
+    FAUSTFLOAT number;
+    
+    if (value && readValue(value, number)) {
+        window.fZones->setParamValue(index, number);
+    }
+    
+    stringstream answer;
+    answer << path << ' ' << jsonNumber(window.fZones->getParamValue(index)) << endl;
+    return sendPage(connection, answer.str().c_str(), answer.str().size(), MHD_HTTP_OK, "text/plain");
+}
+
+//The parameters are given as arguments : <window>/<address>=<value>
+struct controlRequest {
+    map<string, windowInterface>*   fWindows;
+    stringstream                    fAnswer;
+};
+
+static int setWindowParam(void* cls, MHD_ValueKind, const char* key, const char* value)
+{
+    controlRequest* request = (controlRequest*)cls;
+    
+    string param(key);
+    size_t end = param.find('/');
+    
+    if (end == string::npos) {
+        return MHD_YES;
+    }
+    
+    map<string, windowInterface>::iterator it = request->fWindows->find(param.substr(0, end));
+    
+    if (it == request->fWindows->end()) {
+        return MHD_YES;
+    }
+    
+    APIUI* zones = it->second.fZones;
+    int index = zones->getParamIndex(param.substr(end).c_str());
+    
+    if (index >= 0) {
+        FAUSTFLOAT number;
+        if (value && readValue(value, number)) {
+            zones->setParamValue(index, number);
+        }
+        request->fAnswer << param << ' ' << jsonNumber(zones->getParamValue(index)) << endl;
+    }
+    
+    return MHD_YES;
+}
+
+//All the parameters of the request are set at once : the unknown ones are ignored
+int FLServerHttp::handleControlRequest(MHD_Connection* connection)
+{
+    controlRequest request;
+    request.fWindows = &fWindowInterfaces;
+    
+    fWindowsMutex.lock();
+    MHD_get_connection_values(connection, MHD_GET_ARGUMENT_KIND, (MHD_KeyValueIterator)setWindowParam, &request);
+    fWindowsMutex.unlock();
+    
+    string answer = request.fAnswer.str();
+    return sendPage(connection, answer.c_str(), answer.size(), MHD_HTTP_OK, "text/plain");
+}
+
+//The drop zone wrapping the interface of a window : built on the first request for this address, deleted with the interface.
+//fPagesMutex has to be locked
+int FLServerHttp::sendWrappedPage(MHD_Connection* connection, const string& address)
+{
+    map<string, cachedPage*>::iterator it = fWrappedPages.find(address);
+    
+    if (it == fWrappedPages.end()) {
+        it = fWrappedPages.insert(make_pair(address, createCachedPage(fResponseHead + address + fResponseTail, "text/html", false))).first;
+    }
+    
+    return sendCachedPage(connection, it->second);
+}
+
+void FLServerHttp::removeWrappedPage(const string& address)
+{
+    map<string, cachedPage*>::iterator it = fWrappedPages.find(address);
+    
+    if (it != fWrappedPages.end()) {
+        deleteCachedPage(it->second);
+        fWrappedPages.erase(it);
+    }
 }
 
+//The connection is suspended until the application answers the request (see answerRequest)
 int FLServerHttp::handlePost(MHD_Connection* connection, const char* /**url**/, void* info)
 {
     connection_info *con_info = (connection_info*)info;
+    
+    // Called again once the connection is resumed
+    if (con_info->answered) {
+        return sendPage(connection, con_info->answerstring.c_str(), con_info->answerstring.size(), con_info->answercode, con_info->answercode == MHD_HTTP_OK ? "text/plain" : "text/html");
+    }
+    
     int port = 0;
+    string window;
     
-    if (con_info->winUrl.compare("") != 0 && con_info->winUrl.compare(fServerAddress) != 0) {
+    // In single port mode, the interfaces of the windows are served under the address of the server
+    if (fSinglePort && con_info->winUrl.size() > fServerAddress.size() && con_info->winUrl.compare(0, fServerAddress.size(), fServerAddress) == 0) {
+        window = con_info->winUrl.substr(fServerAddress.size());
+        window = window.substr(0, window.find('/'));
+    } else if (con_info->winUrl.compare("") != 0 && con_info->winUrl.compare(fServerAddress) != 0) {
         size_t pos = con_info->winUrl.rfind(":");
         string portNumber = con_info->winUrl.substr(pos+1, con_info->winUrl.size()-pos-2);
         port = atoi(portNumber.c_str()); 
     }
     
-    emit compile(con_info->data.c_str(), port);
-    
-    while (fPosted != true){}
-        
-    fPosted = false;
+    fRequestsMutex.lock();
     
-    if (fCompiled) {
-        con_info->answerstring = fUrl;
-        return sendPage(connection, con_info->answerstring.c_str(), con_info->answerstring.size(), MHD_HTTP_OK, "text/plain");
+    if (fClosed) {
+        fRequestsMutex.unlock();
+        return sendPage(connection, kStoppedPage, strlen(kStoppedPage), MHD_HTTP_SERVICE_UNAVAILABLE, "text/html", true);
     }
+    
+    con_info->requestId = ++fNextRequest;
+    fSuspendedRequests[con_info->requestId] = make_pair(connection, con_info);
+    MHD_suspend_connection(connection);
+    fRequestsMutex.unlock();
+    
+    emit compile(QString::fromStdString(con_info->data), port, QString::fromStdString(window), con_info->requestId);
         
     return MHD_YES;
 }
@@ -195,26 +502,26 @@ int FLServerHttp::answerToConnection(void* cls,
                                     void** con_cls)
 {
     FLServerHttp* server = (FLServerHttp*)cls;
-    string errorPage = kErrorPage;
     
     if (NULL == *con_cls) {
         connection_info* con_info;
     
         if (fUploadingClients >= server->getMaxClients()) {
-            string busyServer(kBusyPage);
-            return server->sendPage(connection, busyServer.c_str (), busyServer.size (), MHD_HTTP_SERVICE_UNAVAILABLE, "text/html");
+            return server->sendPage(connection, kBusyPage, strlen(kBusyPage), MHD_HTTP_SERVICE_UNAVAILABLE, "text/html", true);
         }
         
         con_info = new connection_info();
         con_info->data = "";
         con_info->winUrl = "";
+        con_info->requestId = 0;
+        con_info->answered = false;
         
         if (0 == strcmp(method, "POST")) {
             
             con_info->postprocessor = MHD_create_post_processor(connection, POSTBUFFERSIZE, (MHD_PostDataIterator)iteratePost, (void*)con_info);
             
             if (NULL == con_info->postprocessor) {
-                free(con_info);
+                delete con_info;
                 return MHD_NO;
             }
             
@@ -245,28 +552,99 @@ int FLServerHttp::answerToConnection(void* cls,
             return server->handlePost(connection, url, (void*)con_info);
         }
     } else {
-        return server->sendPage(connection, errorPage.c_str(), errorPage.size(), MHD_HTTP_BAD_REQUEST, "text/html");
+        return server->sendPage(connection, kErrorPage, strlen(kErrorPage), MHD_HTTP_BAD_REQUEST, "text/html", true);
     }
 }
 
 //---------------------- CREATE RETURNING PAGE ------------------------
-int FLServerHttp::sendPage(struct MHD_Connection* connection, const char* page, int length, int status_code, const char* type)
+
+//The persistent pages are not copied : they have to outlive the response (literals, members of the server)
+int FLServerHttp::sendPage(struct MHD_Connection* connection, const char* page, int length, int status_code, const char* type, bool persistent)
 {
     int ret;
     MHD_Response *response;
     
-    response = MHD_create_response_from_buffer(length, (void*)page, MHD_RESPMEM_MUST_COPY);
+    response = MHD_create_response_from_buffer(length, (void*)page, persistent ? MHD_RESPMEM_PERSISTENT : MHD_RESPMEM_MUST_COPY);
     if (!response) {
         return MHD_NO;
     }
     
     MHD_add_response_header(response, "Content-Type", type ? type : "text/plain");
-    cout << "FLServerHttp::sendPage " << status_code << endl;
     ret = MHD_queue_response(connection, status_code, response);
+    MHD_destroy_response(response);
     
     return ret;
 }
 
+//FNV-1a hash of the content, the page changes with its ETag
+static string pageETag(const string& content)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    
+    for (size_t i = 0; i < content.size(); i++) {
+        hash ^= (unsigned char)content[i];
+        hash *= 1099511628211ULL;
+    }
+    
+    char etag[24];
+    snprintf(etag, sizeof(etag), "\"%016llx\"", (unsigned long long)hash);
+    return etag;
+}
+
+cachedPage* FLServerHttp::createCachedPage(const string& content, const char* type, bool persistent)
+{
+    cachedPage* page = new cachedPage();
+    page->fETag = pageETag(content);
+    
+    page->fResponse = MHD_create_response_from_buffer(content.size(), (void*)content.c_str(), persistent ? MHD_RESPMEM_PERSISTENT : MHD_RESPMEM_MUST_COPY);
+    page->fNotModified = MHD_create_response_from_buffer(0, (void*)"", MHD_RESPMEM_PERSISTENT);
+    
+    // The clients check the page again on each request, which costs a 304 when it did not change
+    if (page->fResponse) {
+        MHD_add_response_header(page->fResponse, "Content-Type", type);
+        MHD_add_response_header(page->fResponse, "ETag", page->fETag.c_str());
+        MHD_add_response_header(page->fResponse, "Cache-Control", "no-cache");
+    }
+    if (page->fNotModified) {
+        MHD_add_response_header(page->fNotModified, "ETag", page->fETag.c_str());
+        MHD_add_response_header(page->fNotModified, "Cache-Control", "no-cache");
+    }
+    
+    return page;
+}
+
+//The responses still queued are freed by microhttpd once they are sent
+void FLServerHttp::deleteCachedPage(cachedPage* page)
+{
+    if (!page) {
+        return;
+    }
+    
+    if (page->fResponse) {
+        MHD_destroy_response(page->fResponse);
+    }
+    if (page->fNotModified) {
+        MHD_destroy_response(page->fNotModified);
+    }
+    
+    delete page;
+}
+
+int FLServerHttp::sendCachedPage(struct MHD_Connection* connection, cachedPage* page)
+{
+    if (!page->fResponse || !page->fNotModified) {
+        return MHD_NO;
+    }
+    
+    const char* ifNoneMatch = MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "If-None-Match");
+    
+    if (ifNoneMatch && (strcmp(ifNoneMatch, "*") == 0 || strstr(ifNoneMatch, page->fETag.c_str()))) {
+        return MHD_queue_response(connection, MHD_HTTP_NOT_MODIFIED, page->fNotModified);
+    } else {
+        return MHD_queue_response(connection, MHD_HTTP_OK, page->fResponse);
+    }
+}
+
 //Callback ending a client connection
 void FLServerHttp::requestCompleted(void*, MHD_Connection*, void** con_cls, MHD_RequestTerminationCode)
 {
@@ -288,43 +666,124 @@ void FLServerHttp::requestCompleted(void*, MHD_Connection*, void** con_cls, MHD_
 }
 
 //---------------- FAUST RECOMPILATION RESULT -----------------------------
-void FLServerHttp::compileSuccessfull(const string& url)
+
+//The connection info lives as long as its connection is suspended : the answer is handed over before it is resumed
+void FLServerHttp::answerRequest(int requestId, const string& answer, int answerCode)
+{
+    QMutexLocker locker(&fRequestsMutex);
+    map<int, pair<MHD_Connection*, connection_info*> >::iterator it = fSuspendedRequests.find(requestId);
+    
+    // The request was already answered (server stopped)
+    if (it == fSuspendedRequests.end()) {
+        return;
+    }
+    
+    MHD_Connection* connection = it->second.first;
+    connection_info* con_info = it->second.second;
+    fSuspendedRequests.erase(it);
+    
+    con_info->answerstring = answer;
+    con_info->answercode = answerCode;
+    con_info->answered = true;
+    
+    MHD_resume_connection(connection);
+}
+
+void FLServerHttp::compileSuccessfull(int requestId, const string& url)
+{
+    answerRequest(requestId, url, MHD_HTTP_OK);
+}
+
+void FLServerHttp::compileFailed(int requestId, const string& error)
 {
-    fUrl = url;
-    fCompiled = true;
-    fPosted = true;
+    answerRequest(requestId, kErrorCompile1 + error + kErrorCompile2, MHD_HTTP_BAD_REQUEST);
 }
 
-void FLServerHttp::compileFailed(const string& error)
+//The window compiled a newer source before the one of the request could replace its DSP
+void FLServerHttp::compileSuperseded(int requestId)
 {
-    fCompiled = false;
-    fError = error;    
-    fPosted = true;
+    answerRequest(requestId, kSupersededPage, MHD_HTTP_CONFLICT);
 }
 
 //--------------- HANDLE AVAILABLE HTTP INTERFACES ----------------
 
-void FLServerHttp::declareHttpInterface(int port,  const string& name)
+void FLServerHttp::declareHttpInterface(int port,  const string& name, const string& json)
 {
-     fDeclaredNames[port] = name;
+    fDeclaredNames[port] = name;
+    
+    cachedPage* jsonPage = createCachedPage(json, "application/json", false);
+    
+    fPagesMutex.lock();
+    std::swap(jsonPage, fInterfacesJsons[port]);
+    fPagesMutex.unlock();
+    
+    deleteCachedPage(jsonPage);
+    updateAvailableInterfaces();
+}
+
+void FLServerHttp::declareWindowInterface(const string& window, const string& name, APIUI* zones, const string& json)
+{
+    windowInterface declared;
+    declared.fName = name;
+    declared.fZones = zones;
+    declared.fJson = createCachedPage(json, "application/json", false);
+    
+    fWindowsMutex.lock();
+    std::swap(declared, fWindowInterfaces[window]);
+    fWindowsMutex.unlock();
+    
+    deleteCachedPage(declared.fJson);
+    updateAvailableInterfaces();
+}
+
+void FLServerHttp::removeWindowInterface(const string& window)
+{
+    cachedPage* jsonPage = NULL;
+    
+    fWindowsMutex.lock();
+    map<string, windowInterface>::iterator it = fWindowInterfaces.find(window);
+    if (it != fWindowInterfaces.end()) {
+        jsonPage = it->second.fJson;
+        fWindowInterfaces.erase(it);
+        fRemovedWindows.push_back(window);
+    }
+    fWindowsMutex.unlock();
+    
+    fPagesMutex.lock();
+    removeWrappedPage(fServerAddress + window + "/");
+    fPagesMutex.unlock();
+    
+    deleteCachedPage(jsonPage);
     updateAvailableInterfaces();
 }
 
 void FLServerHttp::removeHttpInterface(int port)
 {
     fDeclaredNames.erase(port);
+    
+    cachedPage* jsonPage = NULL;
+    
+    fPagesMutex.lock();
+    map<int, cachedPage*>::iterator it = fInterfacesJsons.find(port);
+    if (it != fInterfacesJsons.end()) {
+        jsonPage = it->second;
+        fInterfacesJsons.erase(it);
+    }
+    removeWrappedPage(fLocalAddress + QString::number(port).toStdString());
+    fPagesMutex.unlock();
+    
+    deleteCachedPage(jsonPage);
     updateAvailableInterfaces();
 }
 
+//The previous pages may still be sent : microhttpd frees them afterwards
 void FLServerHttp::updateAvailableInterfaces()
 {
     stringstream json;
     stringstream html;
     
-    string interfacesHead = fHome + "/ServerAvailableInterfacesHead.html";
-    
     json << '{';
-    html << readFile(interfacesHead.c_str()).toStdString();
+    html << fInterfacesHead;
     
     html<<"<table width=\"90%\" border=\"0\" cellspacing=\"10\" cellpadding=\"10\" align=\"center\">";
     
@@ -337,71 +796,282 @@ void FLServerHttp::updateAvailableInterfaces()
         html<<"<tr>"<<std::endl;
         html<<"<td>"<<it->second<<"</td>";
         html<<"<td><a href=\""<<it->first<<"\">"<<fServerAddress<<it->first<<"</a></td>"<<std::endl;
-        html<<"<td><iframe width=\"30%\" name=\"iframe name\" height=\"90\" src=\""<<"http://"<<searchLocalIP().toStdString()<<":"<<it->first<<"\" border=\"0\" frameborder=\"0\" scrolling=\"no\" align=\"left\" hspace=\"0\" vspace=\"0\"></iframe></td>"<<std::endl;
+        html<<"<td><iframe width=\"30%\" name=\"iframe name\" height=\"90\" src=\""<<fLocalAddress<<it->first<<"\" border=\"0\" frameborder=\"0\" scrolling=\"no\" align=\"left\" hspace=\"0\" vspace=\"0\"></iframe></td>"<<std::endl;
         html<<"</tr>"<<std::endl;
     }
     
-    json << std::endl << "}";
-    fJson = json.str();
+    // Otherwise, the zones of the windows are only declared for the push channel
+    fWindowsMutex.lock();
+    for (map<string, windowInterface>::iterator it = fWindowInterfaces.begin(); fSinglePort && it != fWindowInterfaces.end(); it++) {
+        
+        if (json.tellp() > 1)
+            json<<',';
+        json << std::endl << '"' << it->second.fName << '"' << ": [" << '"' << it->first << '"' << ']';
+        
+        html<<"<tr>"<<std::endl;
+        html<<"<td>"<<it->second.fName<<"</td>";
+        html<<"<td><a href=\""<<it->first<<"\">"<<fServerAddress<<it->first<<"</a></td>"<<std::endl;
+        html<<"<td><iframe width=\"30%\" name=\"iframe name\" height=\"90\" src=\""<<fServerAddress<<it->first<<"/\" border=\"0\" frameborder=\"0\" scrolling=\"no\" align=\"left\" hspace=\"0\" vspace=\"0\"></iframe></td>"<<std::endl;
+        html<<"</tr>"<<std::endl;
+    }
+    fWindowsMutex.unlock();
     
-    string interfacesTail = fHome + "/ServerAvailableInterfacesTail.html";
+    json << std::endl << "}";
     
     html<<"</table>"<<std::endl;
-    html<<std::endl<<readFile(interfacesTail.c_str()).toStdString();
-    fHtml = html.str();
+    html<<std::endl<<fInterfacesTail;
+    
+    cachedPage* htmlPage = createCachedPage(html.str(), "text/html", false);
+    cachedPage* jsonPage = createCachedPage(json.str(), "application/json", false);
+    
+    fPagesMutex.lock();
+    std::swap(htmlPage, fInterfacesHtml);
+    std::swap(jsonPage, fInterfacesJson);
+    fPagesMutex.unlock();
+    
+    deleteCachedPage(htmlPage);
+    deleteCachedPage(jsonPage);
 }
 
-//-------------- Special treatement for the JSON Request ----------
+//--------------- DSP LOAD OF THE WINDOWS ----------------
 
-// Standard Callback to store the server response to IPadd:5510/JSON
-static size_t store_Response(void* buf, size_t size, size_t nmemb, void* userp)
+//Called by the windows from the GUI thread, read by the daemon thread
+void FLServerHttp::declareDSPLoad(const string& windowName, const string& name, float average, float peak, int xruns, int overBudget)
 {
-    std::ostream* os = static_cast<std::ostream*>(userp);
-    std::streamsize len = size * nmemb;
-    return (os->write(static_cast<char*>(buf), len)) ? len : 0;
+    stringstream json;
+    json << "{\"name\": \"" << name << "\", \"average\": " << average << ", \"peak\": " << peak;
+    json << ", \"xruns\": " << xruns << ", \"overBudget\": " << overBudget << "}";
+    
+    QMutexLocker locker(&fLoadMutex);
+    fDSPLoads[windowName] = json.str();
 }
 
-// A request for the JSON, written as :
-//IPadd:7777/5510/JSON is well redirected to IPadd:5510/JSON
-int FLServerHttp::redirectJsonRequest(struct MHD_Connection *connection, string portNumber)
+void FLServerHttp::removeDSPLoad(const string& windowName)
+{
+    QMutexLocker locker(&fLoadMutex);
+    fDSPLoads.erase(windowName);
+}
+
+string FLServerHttp::getDSPLoads()
+{
+    QMutexLocker locker(&fLoadMutex);
+    stringstream json;
+    
+    json << '{';
+    
+    for (map<string, string>::iterator it = fDSPLoads.begin(); it != fDSPLoads.end(); it++) {
+        if (it != fDSPLoads.begin())
+            json << ',';
+        json << std::endl << '"' << it->first << '"' << ": " << it->second;
+    }
+    
+    json << std::endl << "}";
+    return json.str();
+}
+
+//--------------- PUSH CHANNEL ----------------
+
+//The new client first receives the whole state of the windows
+int FLServerHttp::handleEventsRequest(MHD_Connection* connection)
+{
+    eventClient* client = new eventClient(this, connection);
+    client->fPending = "retry: 1000\n\n" + zonesEvent(true);
+    
+    fEventsMutex.lock();
+    if (fClosed) {
+        fEventsMutex.unlock();
+        delete client;
+        return sendPage(connection, kStoppedPage, strlen(kStoppedPage), MHD_HTTP_SERVICE_UNAVAILABLE, "text/html", true);
+    }
+    if (fEventClients.size() >= kMaxEventClients) {
+        fEventsMutex.unlock();
+        delete client;
+        return sendPage(connection, kBusyPage, strlen(kBusyPage), MHD_HTTP_SERVICE_UNAVAILABLE, "text/html", true);
+    }
+    fEventClients.push_back(client);
+    fEventsMutex.unlock();
+    
+    // The client is forgotten by endEvents when microhttpd is done with the response
+    MHD_Response* response = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN, 4096, (MHD_ContentReaderCallback)readEvents, client, (MHD_ContentReaderFreeCallback)endEvents);
+    
+    if (!response) {
+        endEvents(client);
+        return MHD_NO;
+    }
+    
+    MHD_add_response_header(response, "Content-Type", "text/event-stream");
+    MHD_add_response_header(response, "Cache-Control", "no-cache");
+    MHD_add_response_header(response, "Access-Control-Allow-Origin", "*");
+    
+    int ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+    MHD_destroy_response(response);
+    
+    return ret;
+}
+
+//Called by the daemon thread : with nothing to send, the connection is suspended until pushChanges resumes it
+ssize_t FLServerHttp::readEvents(void* cls, uint64_t /*pos*/, char* buf, size_t max)
 {
-#ifndef WIN32
-	string resultingPage = "";
-    stringstream url; 
+    eventClient* client = (eventClient*)cls;
+    QMutexLocker locker(&client->fServer->fEventsMutex);
     
-    url<<"http://"<< searchLocalIP().toStdString().c_str() <<":"<<portNumber.c_str()<< "/JSON";
-    string finalURL = url.str();
-    CURL *curl = curl_easy_init();
+    if (client->fPending.empty()) {
+        
+        if (client->fClosed || client->fServer->fClosed) {
+            return MHD_CONTENT_READER_END_OF_STREAM;
+        }
+        
+        client->fSuspended = true;
+        MHD_suspend_connection(client->fConnection);
+        return 0;
+    }
     
-    long respcode = MHD_HTTP_BAD_REQUEST; 
+    size_t size = std::min(max, client->fPending.size());
+    memcpy(buf, client->fPending.data(), size);
+    client->fPending.erase(0, size);
     
-    if (curl) {
+    return size;
+}
+
+void FLServerHttp::endEvents(void* cls)
+{
+    eventClient* client = (eventClient*)cls;
+    
+    client->fServer->fEventsMutex.lock();
+    client->fServer->fEventClients.remove(client);
+    client->fServer->fEventsMutex.unlock();
+    
+    delete client;
+}
+
+//The values of the zones of all the windows, or only the ones that changed since the previous push, as one event.
+//A removed window is sent as null.
+string FLServerHttp::zonesEvent(bool all)
+{
+    stringstream data;
+    QMutexLocker locker(&fWindowsMutex);
+    
+    if (!all) {
+        for (vector<string>::iterator it = fRemovedWindows.begin(); it != fRemovedWindows.end(); it++) {
+            if (data.tellp() > 0)
+                data << ", ";
+            data << jsonString(*it) << ": null";
+        }
+        fRemovedWindows.clear();
+    }
+    
+    for (map<string, windowInterface>::iterator it = fWindowInterfaces.begin(); it != fWindowInterfaces.end(); it++) {
         
-        std::ostringstream oss;
+        windowInterface& window = it->second;
+        int count = window.fZones->getParamsCount();
         
-        curl_easy_setopt(curl, CURLOPT_URL, finalURL.c_str());
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &store_Response);
-        curl_easy_setopt(curl, CURLOPT_FILE, &oss);
-        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 60); 
-        curl_easy_setopt(curl,CURLOPT_TIMEOUT, 600);
+        // The window was declared since the previous push
+        bool declared = ((int)window.fValues.size() != count);
         
-        CURLcode res = curl_easy_perform(curl);
+        if (!all && declared) {
+            window.fValues.assign(count, 0);
+        }
         
-        if (res == CURLE_OK) {
-
-            curl_easy_getinfo(curl,CURLINFO_RESPONSE_CODE, &respcode);
+        stringstream zones;
+        
+        for (int i = 0; i < count; i++) {
+            
+            double value = window.fZones->getParamValue(i);
             
-            if (respcode == 200)
-                resultingPage = oss.str();
+            // A NaN is only sent when it appears
+            bool changed = (value != window.fValues[i]) && !(std::isnan(value) && std::isnan(window.fValues[i]));
+            
+            if (all || declared || changed) {
+                
+                if (!all) {
+                    window.fValues[i] = value;
+                }
+                
+                if (zones.tellp() > 0)
+                    zones << ", ";
+                zones << jsonString(window.fZones->getParamAddress(i)) << ": " << jsonNumber(value);
+            }
+        }
+        
+        if (zones.tellp() > 0) {
+            if (data.tellp() > 0)
+                data << ", ";
+            data << jsonString(it->first) << ": {" << zones.str() << '}';
         }
+    }
+    
+    if (data.tellp() <= 0) {
+        return "";
+    }
+    
+    return "event: zones\ndata: {" + data.str() + "}\n\n";
+}
+
+//Called by the push timer in the GUI thread : the zones are only compared when someone listens
+void FLServerHttp::pushChanges()
+{
+    fEventsMutex.lock();
+    bool listened = !fEventClients.empty();
+    fEventsMutex.unlock();
+    
+    if (!listened) {
+        fWindowsMutex.lock();
+        fRemovedWindows.clear();
+        fWindowsMutex.unlock();
+        return;
+    }
+    
+    string event = zonesEvent(false);
+    fIdleTime = event.empty() ? fIdleTime + fPushTimer->interval() : 0;
+    
+    // A comment now and then shows the clients that went away
+    if (fIdleTime >= kEventKeepAlive) {
+        event = ": keep-alive\n\n";
+        fIdleTime = 0;
+    }
+    
+    if (event.empty()) {
+        return;
+    }
+    
+    QMutexLocker locker(&fEventsMutex);
+    
+    for (list<eventClient*>::iterator it = fEventClients.begin(); it != fEventClients.end(); it++) {
+        
+        eventClient* client = *it;
         
-        curl_easy_cleanup(curl);
-    }    
+        if (client->fClosed) {
+            continue;
+        }
+        
+        if (client->fPending.size() + event.size() > kMaxEventBacklog) {
+            client->fPending.clear();
+            client->fClosed = true;
+        } else {
+            client->fPending += event;
+        }
+        
+        if (client->fSuspended) {
+            client->fSuspended = false;
+            MHD_resume_connection(client->fConnection);
+        }
+    }
+}
+
+//-------------- Special treatement for the JSON Request ----------
+
+// A request for the JSON, written as :
+//IPadd:7777/5510/JSON is answered with the description given by the window listening on 5510
+int FLServerHttp::redirectJsonRequest(struct MHD_Connection *connection, string portNumber)
+{
+    QMutexLocker locker(&fPagesMutex);
+    map<int, cachedPage*>::iterator it = fInterfacesJsons.find(atoi(portNumber.c_str()));
     
-    return sendPage(connection, resultingPage.c_str(), resultingPage.size(), respcode, "application/json");
-#else
-return 1;
-#endif
+    if (it == fInterfacesJsons.end()) {
+        return sendPage(connection, "", 0, MHD_HTTP_BAD_REQUEST, "application/json", true);
+    }
+    
+    return sendCachedPage(connection, it->second);
 }
 
 //----------Accessor to Max Client Number--------
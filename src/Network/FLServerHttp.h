@@ -9,13 +9,34 @@
 // The GET requests treated by FLServer are :
 //         /availableInterfaces --> returns an HTML page describing all available HTML interfaces
 //         /availableInterfaces/JSON --> returns the available interfaces as a JSON description
+//         /stats/compile       --> returns the duration of the phases of the last compilations and the factory cache hits as JSON
+//         /stats/compile/CSV   --> same thing as CSV
+//         /stats/load          --> returns the DSP load of each window as JSON
 //         /                    --> HTML page with only a drop zone
 //         /<portNumber>        --> HTML page with drop zone and interface connresponding to <portNumber>
+//         /<portNumber>/JSON   --> JSON description of the interface, as declared by its window
+//
+// In single port mode (General/Network/HttpSinglePort), the windows do not run their own httpdUI : they are controlled through the server
+//         /<window>            --> HTML page with drop zone and interface of the window
+//         /<window>/           --> HTML interface of the window, built from its JSON description
+//         /<window>/JSON       --> JSON description of the window interface
+//         /<window>/<address>[?value=v] --> sets the parameter if a value is given and returns its value
+//
+// The remote clients do not have to poll the interfaces of the windows :
+//         /events              --> Server-Sent Events stream. The values of all the zones are sent when connecting, then only
+//                                  the ones that changed, coalesced in one event every General/Network/HttpPushRate ms
+//         /control?<window>/<address>=v&... --> sets several parameters of any windows at once and returns their values
 //
 // The POST request treated by FLServer is :
 //         receiving Faust code --> compilation --> return url to HTML interface
+// The window to update is found from the interface the code was dropped on : its port, or its name in single port mode
+//
+// The connection is suspended while the application compiles : each drop is a request of its own, answered
+// by compileSuccessfull/compileFailed with its id, so that concurrent drops do not wait for each other.
+// A drop replaced in its window by a newer source before its compilation was over is answered by compileSuperseded (409).
 //
-// The HTML wrappers are stored in Resources/Html
+// The HTML wrappers are stored in Resources/Html. They are read once, when the server is created, and the pages
+// that do not change between two requests are answered with the same microhttpd response, along with an ETag
 //
 // See ServerHTTPSpecification in documentation for further implementation
 
@@ -23,13 +44,16 @@
 #define _FLSERVERHTTP_h
 
 #define kBusyPage  "<html><body>FaustLive Server is busy, please try again later.</body></html>"
+#define kStoppedPage "<html><body>FaustLive Server is being stopped.</body></html>"
 #define kErrorPage "<html>\n<body>ERROR</body>\n</html>"
 #define kErrorCompile1 "<html>\n<body>\nImpossible to compile this file : \n"
 #define kErrorCompile2 "\n</body>\n</html>"
+#define kSupersededPage "<html>\n<body>\nSuperseded : another source was compiled in the window before this one was over\n</body>\n</html>"
 
 #include <sstream>
 #include <iostream>
 #include <fstream>
+#include <list>
 #include <map>
 #include <vector>
 #include <string>
@@ -40,6 +64,8 @@
 #include <microhttpd.h>
 
 #include <QObject>
+#include <QMutex>
+#include <atomic>
 
 #undef min
 #undef max
@@ -47,6 +73,11 @@
 using namespace std;
 
 #define POSTBUFFERSIZE 512
+#define kDefaultHttpThreads 4   // Thread pool of the daemon in single port mode
+#define kDefaultHttpPushRate 100    // ms
+#define kEventKeepAlive 15000       // ms : a comment is sent to the event clients when nothing changed for that long
+#define kMaxEventClients 32
+#define kMaxEventBacklog 1048576    // A client that does not read its events is disconnected, it gets the whole state when it reconnects
 
 #define GET 0
 #define POST 1
@@ -62,8 +93,50 @@ struct connection_info {
     string winUrl;                              // To be able to replace faust content in the right FLWindow
     std::string answerstring;                   // the answer sent to the user after upload
     
+    int requestId;                              // Compile request, 0 until the upload is over
+    bool answered;                              // The compilation is over, the connection was resumed
+    
+};
+
+// A response built once and queued as many times as requested (microhttpd counts its references)
+struct cachedPage {
+    
+    MHD_Response*   fResponse;
+    MHD_Response*   fNotModified;       // 304 answer to a matching If-None-Match
+    string          fETag;
+    
+    cachedPage() : fResponse(NULL), fNotModified(NULL) {}
 };
 
+class APIUI;
+
+// Interface of a window controlled through the server
+struct windowInterface {
+    
+    string          fName;
+    APIUI*          fZones;         // Belongs to the window
+    cachedPage*     fJson;
+    vector<double>  fValues;        // Last values pushed to the event clients
+    
+    windowInterface() : fZones(NULL), fJson(NULL) {}
+};
+
+class FLServerHttp;
+
+// Client of the /events stream : its connection is suspended while it has nothing to read
+struct eventClient {
+    
+    FLServerHttp*   fServer;
+    MHD_Connection* fConnection;
+    string          fPending;
+    bool            fSuspended;
+    bool            fClosed;        // The stream ends once fPending is sent
+    
+    eventClient(FLServerHttp* server, MHD_Connection* connection) : fServer(server), fConnection(connection), fSuspended(false), fClosed(false) {}
+};
+
+class QTimer;
+
 class FLServerHttp : public QObject
 {
     
@@ -72,22 +145,70 @@ class FLServerHttp : public QObject
         Q_OBJECT
         
         int             fMaxCients;
-        string          fError;         // Not important right now
-        string          fUrl;           // Url of wrapped http page 
+    
+    //Set by stop with fRequestsMutex and fEventsMutex locked : no connection is suspended afterwards
+        bool            fClosed;
         
-        bool            fPosted;        // Post request completed
-        bool            fCompiled;      // Compilation sucess
+    //Connections suspended until their compilation is over, by request id
+        QMutex                          fRequestsMutex;
+        map<int, pair<MHD_Connection*, connection_info*> > fSuspendedRequests;
+        int                             fNextRequest;
+    
+        void            answerRequest(int requestId, const string& answer, int answerCode);
         
+        string          fLocalAddress;      // http://<local IP>: , computed when the server starts
         string          fServerAddress;
-        string          fJson;
-        string          fHtml;
         string          fHome;
+    
+    //Wrappers read from fHome when the server is created
+        string          fResponseHead;
+        string          fResponseTail;
+        string          fInterfacesHead;
+        string          fInterfacesTail;
+    
+        string          fRootPage;          // Lives as long as the server : its response does not copy it
+        cachedPage*     fRootResponse;
+        string          fWindowPage;        // Same for the HTML interface of the windows in single port mode
+        cachedPage*     fWindowResponse;
+    
+    //Rebuilt by the GUI thread when a window declares or removes its interface
+        QMutex          fPagesMutex;
+        cachedPage*     fInterfacesHtml;
+        cachedPage*     fInterfacesJson;
+        map<int, cachedPage*> fInterfacesJsons;     // Description of each interface, by port
+    
+        map<string, cachedPage*> fWrappedPages;     // By interface address, for the declared interfaces only
+    
+    //Windows controlled through the server : the zones are only used with the mutex locked
+        bool                            fSinglePort;
+        QMutex                          fWindowsMutex;
+        map<string, windowInterface>    fWindowInterfaces;
+    
+        vector<string>                  fRemovedWindows;    // Until the next push
+    
+        int             handleWindowRequest(MHD_Connection* connection, windowInterface& window, const string& path);
+        int             handleControlRequest(MHD_Connection* connection);
+    
+    //Push channel, fed by the GUI thread
+        QMutex              fEventsMutex;
+        list<eventClient*>  fEventClients;
+        QTimer*             fPushTimer;
+        int                 fIdleTime;          // ms since the last event
+    
+        int             handleEventsRequest(MHD_Connection* connection);
+        string          zonesEvent(bool all);
+    
+        static ssize_t  readEvents(void* cls, uint64_t pos, char* buf, size_t max);
+        static void     endEvents(void* cls);
         
         map<int, string>     fDeclaredNames;
+    
+        QMutex               fLoadMutex;
+        map<string, string>  fDSPLoads;     // JSON description of the load of each window
         
         static FLServerHttp*    _serverInstance;
         
-        static int      fUploadingClients;
+        static std::atomic<int> fUploadingClients;
         
         struct          MHD_Daemon* fDaemon;
         
@@ -95,9 +216,16 @@ class FLServerHttp : public QObject
         int             handlePost(MHD_Connection* connection, const char* url, void* info);
         
         void            updateAvailableInterfaces();
+        string          getDSPLoads();
         int             getMaxClients();
         
-        int             sendPage(struct MHD_Connection *connection, const char* page, int length, int status_code, const char* type = 0);
+        int             sendPage(struct MHD_Connection *connection, const char* page, int length, int status_code, const char* type = 0, bool persistent = false);
+    
+        static cachedPage*  createCachedPage(const string& content, const char* type, bool persistent);
+        static void         deleteCachedPage(cachedPage* page);
+        int                 sendCachedPage(struct MHD_Connection *connection, cachedPage* page);
+        int                 sendWrappedPage(struct MHD_Connection *connection, const string& address);
+        void                removeWrappedPage(const string& address);
         
         static int      answerToConnection(void* cls, struct MHD_Connection* connection,
                                          const char* url, const char* method,
@@ -124,20 +252,37 @@ class FLServerHttp : public QObject
         bool        start();
         void        stop();
         
-        void        declareHttpInterface(int port, const string& name);
+    //The JSON description of the interface is served for <port>/JSON until it is removed or declared again
+        void        declareHttpInterface(int port, const string& name, const string& json);
+    
+    //Single port mode : once removeWindowInterface returns, the zones of the window are not used anymore
+        bool        isSinglePort() { return fSinglePort; }
+        void        declareWindowInterface(const string& window, const string& name, APIUI* zones, const string& json);
+        void        removeWindowInterface(const string& window);
         void        removeHttpInterface(int port);
+    
+    //Load in % of the audio period (see AudioFader_LoadMeter)
+        void        declareDSPLoad(const string& windowName, const string& name, float average, float peak, int xruns, int overBudget);
+        void        removeDSPLoad(const string& windowName);
         
-        void        compileSuccessfull(const string& url);
-        void        compileFailed(const string& error);
+    //Called by the application from the GUI thread : the client of the request is answered
+        void        compileSuccessfull(int requestId, const string& url);
+        void        compileFailed(int requestId, const string& error);
+        void        compileSuperseded(int requestId);
       
         static void createInstance(const string& homeFolder);
         static void deleteInstance();
           
         static      FLServerHttp* _Instance();
           
+    private slots:
+    
+        void        pushChanges();
+    
     signals:
         
-        void compile(const char*, int);
+    //The source is compiled in the window of the interface (port in multiple ports mode, window in single port mode), or in a new window if both are empty
+        void compile(const QString& source, int port, const QString& window, int requestId);
     
 };
 